@@ -0,0 +1,232 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "DataAccessStats.h"
+
+DEFINE_STAT(STAT_DataAccess_Create);
+DEFINE_STAT(STAT_DataAccess_CreateMany);
+DEFINE_STAT(STAT_DataAccess_Update);
+DEFINE_STAT(STAT_DataAccess_UpdateMany);
+DEFINE_STAT(STAT_DataAccess_UpdateWhere);
+DEFINE_STAT(STAT_DataAccess_Delete);
+DEFINE_STAT(STAT_DataAccess_Count);
+DEFINE_STAT(STAT_DataAccess_First);
+DEFINE_STAT(STAT_DataAccess_Get);
+DEFINE_STAT(STAT_DataAccess_Aggregate);
+DEFINE_STAT(STAT_DataAccess_ExecuteQuery);
+DEFINE_STAT(STAT_DataAccess_BuildSql);
+DEFINE_STAT(STAT_DataAccess_Prepare);
+DEFINE_STAT(STAT_DataAccess_Bind);
+DEFINE_STAT(STAT_DataAccess_Step);
+DEFINE_STAT(STAT_DataAccess_Decode);
+DEFINE_STAT(STAT_DataAccess_RowsRead);
+DEFINE_STAT(STAT_DataAccess_RowsWritten);
+DEFINE_STAT(STAT_DataAccess_BytesRead);
+DEFINE_STAT(STAT_DataAccess_BytesWritten);
+DEFINE_STAT(STAT_DataAccess_StatementCacheHits);
+DEFINE_STAT(STAT_DataAccess_StatementCacheMisses);
+DEFINE_STAT(STAT_DataAccess_StatementCacheEvictions);
+
+namespace DataAccessMetricsHelpers
+{
+    void DumpStats()
+    {
+        FDataAccessMetrics::Get().Dump(*GLog);
+    }
+
+    void ResetStats()
+    {
+        FDataAccessMetrics::Get().Reset();
+    }
+
+    static FAutoConsoleCommand DumpStatsCommand(
+        TEXT("DataAccess.DumpStats"),
+        TEXT("Log latency histograms per data handler operation and phase, rows and bytes read and written and statement cache stats"),
+        FConsoleCommandDelegate::CreateStatic(&DumpStats));
+
+    static FAutoConsoleCommand ResetStatsCommand(
+        TEXT("DataAccess.ResetStats"),
+        TEXT("Reset every data access histogram and counter"),
+        FConsoleCommandDelegate::CreateStatic(&ResetStats));
+
+    void DumpHistogram(FOutputDevice& Ar, const TCHAR* Name, const FDataAccessLatencyHistogram& Histogram)
+    {
+        const int64 Count = Histogram.GetCount();
+        if(Count == 0)
+        {
+            return;
+        }
+
+        Ar.Logf(TEXT("  %-14s count %8lld  avg %9.3f ms  p50 %9.3f ms  p99 %9.3f ms  max %9.3f ms  total %10.3f ms"),
+            Name, Count, Histogram.GetTotalMs() / Count, Histogram.GetPercentileMs(0.5f), Histogram.GetPercentileMs(0.99f), Histogram.GetMaxMs(), Histogram.GetTotalMs());
+
+        FString Buckets;
+        for(int32 i = 0; i < FDataAccessLatencyHistogram::NumBuckets; ++i)
+        {
+            if(Histogram.GetBucket(i) > 0)
+            {
+                Buckets += FString::Printf(TEXT(" <%lldus:%lld"), 1ll << (i + 1), Histogram.GetBucket(i));
+            }
+        }
+        Ar.Logf(TEXT("  %-14s%s"), TEXT(""), *Buckets);
+    }
+}
+
+FDataAccessLatencyHistogram::FDataAccessLatencyHistogram()
+{
+    Reset();
+}
+
+void FDataAccessLatencyHistogram::Add(double Seconds)
+{
+    const int64 Microseconds = FMath::Max<int64>(static_cast<int64>(Seconds * 1000000.0), 0);
+    const int32 Bucket = Microseconds > 0 ? FMath::Min<int32>(FMath::FloorLog2(static_cast<uint32>(FMath::Min<int64>(Microseconds, MAX_uint32))), NumBuckets - 1) : 0;
+
+    FPlatformAtomics::InterlockedIncrement(&Count);
+    FPlatformAtomics::InterlockedAdd(&TotalMicroseconds, Microseconds);
+    FPlatformAtomics::InterlockedIncrement(&Buckets[Bucket]);
+
+    int64 CurrentMax = MaxMicroseconds;
+    while(Microseconds > CurrentMax)
+    {
+        const int64 PreviousMax = FPlatformAtomics::InterlockedCompareExchange(&MaxMicroseconds, Microseconds, CurrentMax);
+        if(PreviousMax == CurrentMax)
+        {
+            break;
+        }
+        CurrentMax = PreviousMax;
+    }
+}
+
+double FDataAccessLatencyHistogram::GetPercentileMs(float Percentile) const
+{
+    const int64 Total = Count;
+    if(Total == 0)
+    {
+        return 0.0;
+    }
+
+    const double ExactRank = Total * static_cast<double>(FMath::Clamp(Percentile, 0.f, 1.f));
+    int64 Rank = static_cast<int64>(ExactRank);
+    if(Rank < ExactRank || Rank == 0)
+    {
+        ++Rank;
+    }
+
+    int64 Seen = 0;
+    for(int32 i = 0; i < NumBuckets; ++i)
+    {
+        Seen += Buckets[i];
+        if(Seen >= Rank)
+        {
+            // No sample is slower than the max, which is tighter than the bucket bound for the last bucket
+            return FMath::Min((1ll << (i + 1)) / 1000.0, GetMaxMs());
+        }
+    }
+
+    return GetMaxMs();
+}
+
+void FDataAccessLatencyHistogram::Reset()
+{
+    Count = 0;
+    TotalMicroseconds = 0;
+    MaxMicroseconds = 0;
+    FMemory::Memzero(const_cast<int64*>(Buckets), sizeof(Buckets));
+}
+
+FDataAccessMetrics& FDataAccessMetrics::Get()
+{
+    static FDataAccessMetrics Metrics;
+    return Metrics;
+}
+
+FDataAccessMetrics::FDataAccessMetrics()
+{
+    FMemory::Memzero(const_cast<int64*>(Counters), sizeof(Counters));
+}
+
+void FDataAccessMetrics::Increment(EDataAccessCounter::Type Counter, int64 Amount)
+{
+    FPlatformAtomics::InterlockedAdd(&Counters[Counter], Amount);
+}
+
+void FDataAccessMetrics::Dump(FOutputDevice& Ar) const
+{
+    Ar.Logf(TEXT("Data access operations:"));
+    for(int32 i = 0; i < EDataAccessOperation::Num; ++i)
+    {
+        DataAccessMetricsHelpers::DumpHistogram(Ar, GetOperationName(static_cast<EDataAccessOperation::Type>(i)), Operations[i]);
+    }
+
+    Ar.Logf(TEXT("Data access phases:"));
+    for(int32 i = 0; i < EDataAccessPhase::Num; ++i)
+    {
+        DataAccessMetricsHelpers::DumpHistogram(Ar, GetPhaseName(static_cast<EDataAccessPhase::Type>(i)), Phases[i]);
+    }
+
+    Ar.Logf(TEXT("Data access counters:"));
+    for(int32 i = 0; i < EDataAccessCounter::Num; ++i)
+    {
+        Ar.Logf(TEXT("  %-24s %lld"), GetCounterName(static_cast<EDataAccessCounter::Type>(i)), Counters[i]);
+    }
+}
+
+void FDataAccessMetrics::Reset()
+{
+    for(FDataAccessLatencyHistogram& Histogram : Operations)
+    {
+        Histogram.Reset();
+    }
+    for(FDataAccessLatencyHistogram& Histogram : Phases)
+    {
+        Histogram.Reset();
+    }
+    FMemory::Memzero(const_cast<int64*>(Counters), sizeof(Counters));
+}
+
+const TCHAR* FDataAccessMetrics::GetOperationName(EDataAccessOperation::Type Operation)
+{
+    switch(Operation)
+    {
+    case EDataAccessOperation::Create:          return TEXT("Create");
+    case EDataAccessOperation::CreateMany:      return TEXT("CreateMany");
+    case EDataAccessOperation::Update:          return TEXT("Update");
+    case EDataAccessOperation::UpdateMany:      return TEXT("UpdateMany");
+    case EDataAccessOperation::UpdateWhere:     return TEXT("UpdateWhere");
+    case EDataAccessOperation::Delete:          return TEXT("Delete");
+    case EDataAccessOperation::Count:           return TEXT("Count");
+    case EDataAccessOperation::First:           return TEXT("First");
+    case EDataAccessOperation::Get:             return TEXT("Get");
+    case EDataAccessOperation::Aggregate:       return TEXT("Aggregate");
+    case EDataAccessOperation::ExecuteQuery:    return TEXT("ExecuteQuery");
+    default:                                    return TEXT("Unknown");
+    }
+}
+
+const TCHAR* FDataAccessMetrics::GetPhaseName(EDataAccessPhase::Type Phase)
+{
+    switch(Phase)
+    {
+    case EDataAccessPhase::BuildSql:    return TEXT("BuildSql");
+    case EDataAccessPhase::Prepare:     return TEXT("Prepare");
+    case EDataAccessPhase::Bind:        return TEXT("Bind");
+    case EDataAccessPhase::Step:        return TEXT("Step");
+    case EDataAccessPhase::Decode:      return TEXT("Decode");
+    default:                            return TEXT("Unknown");
+    }
+}
+
+const TCHAR* FDataAccessMetrics::GetCounterName(EDataAccessCounter::Type Counter)
+{
+    switch(Counter)
+    {
+    case EDataAccessCounter::RowsRead:                  return TEXT("RowsRead");
+    case EDataAccessCounter::RowsWritten:               return TEXT("RowsWritten");
+    case EDataAccessCounter::BytesRead:                 return TEXT("BytesRead");
+    case EDataAccessCounter::BytesWritten:              return TEXT("BytesWritten");
+    case EDataAccessCounter::StatementCacheHits:        return TEXT("StatementCacheHits");
+    case EDataAccessCounter::StatementCacheMisses:      return TEXT("StatementCacheMisses");
+    case EDataAccessCounter::StatementCacheEvictions:   return TEXT("StatementCacheEvictions");
+    default:                                            return TEXT("Unknown");
+    }
+}
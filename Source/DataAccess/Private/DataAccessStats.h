@@ -0,0 +1,71 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#pragma once
+
+#include "DataAccessMetrics.h"
+
+DECLARE_STATS_GROUP(TEXT("DataAccess"), STATGROUP_DataAccess, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create"), STAT_DataAccess_Create, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("CreateMany"), STAT_DataAccess_CreateMany, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update"), STAT_DataAccess_Update, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateMany"), STAT_DataAccess_UpdateMany, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateWhere"), STAT_DataAccess_UpdateWhere, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Delete"), STAT_DataAccess_Delete, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Count"), STAT_DataAccess_Count, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("First"), STAT_DataAccess_First, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Get"), STAT_DataAccess_Get, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Aggregate"), STAT_DataAccess_Aggregate, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ExecuteQuery"), STAT_DataAccess_ExecuteQuery, STATGROUP_DataAccess, );
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build SQL"), STAT_DataAccess_BuildSql, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Prepare"), STAT_DataAccess_Prepare, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bind"), STAT_DataAccess_Bind, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Step"), STAT_DataAccess_Step, STATGROUP_DataAccess, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode"), STAT_DataAccess_Decode, STATGROUP_DataAccess, );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Rows read"), STAT_DataAccess_RowsRead, STATGROUP_DataAccess, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Rows written"), STAT_DataAccess_RowsWritten, STATGROUP_DataAccess, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Bytes read"), STAT_DataAccess_BytesRead, STATGROUP_DataAccess, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Bytes written"), STAT_DataAccess_BytesWritten, STATGROUP_DataAccess, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Statement cache hits"), STAT_DataAccess_StatementCacheHits, STATGROUP_DataAccess, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Statement cache misses"), STAT_DataAccess_StatementCacheMisses, STATGROUP_DataAccess, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Statement cache evictions"), STAT_DataAccess_StatementCacheEvictions, STATGROUP_DataAccess, );
+
+#if DATAACCESS_METRICS
+
+/** Time the rest of the scope as a data handler operation, e.g. DATAACCESS_SCOPE_OPERATION(First) */
+#define DATAACCESS_SCOPE_OPERATION(Operation) \
+    SCOPE_CYCLE_COUNTER(STAT_DataAccess_##Operation); \
+    FDataAccessScopeTimer DataAccessOperationTimer(FDataAccessMetrics::Get().GetOperation(EDataAccessOperation::Operation))
+
+/** Time the rest of the scope as a phase of an operation, e.g. DATAACCESS_SCOPE_PHASE(Bind) */
+#define DATAACCESS_SCOPE_PHASE(Phase) \
+    SCOPE_CYCLE_COUNTER(STAT_DataAccess_##Phase); \
+    FDataAccessScopeTimer DataAccessPhaseTimer(FDataAccessMetrics::Get().GetPhase(EDataAccessPhase::Phase))
+
+/** Add to a counter, e.g. DATAACCESS_INC_COUNTER(RowsRead, 1).  Amount is not evaluated when metrics are compiled out. */
+#define DATAACCESS_INC_COUNTER(Counter, Amount) \
+    do \
+    { \
+        int64 DataAccessAmount = (Amount); \
+        INC_DWORD_STAT_BY(STAT_DataAccess_##Counter, DataAccessAmount); \
+        FDataAccessMetrics::Get().Increment(EDataAccessCounter::Counter, DataAccessAmount); \
+    } while(0)
+
+#else
+
+#define DATAACCESS_SCOPE_OPERATION(Operation)
+#define DATAACCESS_SCOPE_PHASE(Phase)
+#define DATAACCESS_INC_COUNTER(Counter, Amount) do {} while(0)
+
+#endif
+
+/**
+ * sqlite3_step timed as the Step phase
+ */
+FORCEINLINE int32 SqliteStepTimed(sqlite3_stmt* const SqliteStatement)
+{
+    DATAACCESS_SCOPE_PHASE(Step);
+    return sqlite3_step(SqliteStatement);
+}
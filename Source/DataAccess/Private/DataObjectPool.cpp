@@ -0,0 +1,68 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#include "DataAccessPrivatePCH.h"
+#include "DataObjectPool.h"
+
+FDataObjectPool::FDataObjectPool(int32 MaxFreePerClass)
+: MaxFreePerClass(MaxFreePerClass)
+{}
+
+FDataObjectPool::~FDataObjectPool()
+{
+    Empty();
+}
+
+UObject* FDataObjectPool::Acquire(UClass* Class)
+{
+    check(Class);
+    
+    TArray<UObject*>* Free = FreeObjects.Find(Class);
+    if(Free && Free->Num() > 0)
+    {
+        return Free->Pop(false);
+    }
+    
+    return NewObject<UObject>(GetTransientPackage(), Class);
+}
+
+void FDataObjectPool::Release(UObject* Obj)
+{
+    if(!Obj)
+    {
+        return;
+    }
+    
+    TArray<UObject*>& Free = FreeObjects.FindOrAdd(Obj->GetClass());
+    if(Free.Num() < MaxFreePerClass)
+    {
+        Free.Add(Obj);
+    }
+}
+
+void FDataObjectPool::Release(TArray<UObject*>& Objs)
+{
+    for(UObject* Obj : Objs)
+    {
+        Release(Obj);
+    }
+    Objs.Reset();
+}
+
+void FDataObjectPool::Empty()
+{
+    FreeObjects.Empty();
+}
+
+int32 FDataObjectPool::NumFree(UClass* Class) const
+{
+    const TArray<UObject*>* Free = FreeObjects.Find(Class);
+    return Free ? Free->Num() : 0;
+}
+
+void FDataObjectPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    for(auto Itr = FreeObjects.CreateIterator(); Itr; ++Itr)
+    {
+        Collector.AddReferencedObjects(Itr.Value());
+    }
+}
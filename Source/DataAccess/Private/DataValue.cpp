@@ -0,0 +1,83 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "DataValue.h"
+
+FDataValue FDataValue::FromString(const FString& Text, EDataValueType::Type AsType)
+{
+    switch(AsType)
+    {
+    case EDataValueType::Integer:
+        return FDataValue(FCString::Strtoi64(*Text, nullptr, 10));
+    case EDataValueType::Real:
+        return FDataValue(FCString::Atod(*Text));
+    case EDataValueType::Text:
+        return FDataValue(Text);
+    default:
+        return FDataValue();
+    }
+}
+
+int64 FDataValue::AsInt64() const
+{
+    switch(Type)
+    {
+    case EDataValueType::Integer:
+        return IntegerValue;
+    case EDataValueType::Real:
+        return static_cast<int64>(RealValue);
+    case EDataValueType::Text:
+        return FCString::Strtoi64(*TextValue, nullptr, 10);
+    default:
+        return 0;
+    }
+}
+
+double FDataValue::AsDouble() const
+{
+    switch(Type)
+    {
+    case EDataValueType::Integer:
+        return static_cast<double>(IntegerValue);
+    case EDataValueType::Real:
+        return RealValue;
+    case EDataValueType::Text:
+        return FCString::Atod(*TextValue);
+    default:
+        return 0.0;
+    }
+}
+
+FString FDataValue::AsString() const
+{
+    switch(Type)
+    {
+    case EDataValueType::Integer:
+        return FString::Printf(TEXT("%lld"), IntegerValue);
+    case EDataValueType::Real:
+        return FString::Printf(TEXT("%.17g"), RealValue);
+    case EDataValueType::Text:
+        return TextValue;
+    default:
+        return FString();
+    }
+}
+
+bool FDataValue::operator==(const FDataValue& Other) const
+{
+    if(Type != Other.Type)
+    {
+        return false;
+    }
+
+    switch(Type)
+    {
+    case EDataValueType::Integer:
+        return IntegerValue == Other.IntegerValue;
+    case EDataValueType::Real:
+        return RealValue == Other.RealValue;
+    case EDataValueType::Text:
+        return TextValue.Equals(Other.TextValue, ESearchCase::CaseSensitive);
+    default:
+        return true;
+    }
+}
@@ -0,0 +1,124 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#include "DataAccessPrivatePCH.h"
+#include "DataWriteBehindQueue.h"
+#include "Ticker.h"
+
+FDataWriteBehindQueue::FDataWriteBehindQueue(TSharedRef<IDataHandler> DataHandler, float FlushInterval)
+: DataHandler(DataHandler)
+{
+    if(FlushInterval > 0.f)
+    {
+        TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FDataWriteBehindQueue::Tick), FlushInterval);
+    }
+}
+
+FDataWriteBehindQueue::~FDataWriteBehindQueue()
+{
+    if(TickerHandle.IsValid())
+    {
+        FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+    }
+    
+    if(!Flush())
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("~FDataWriteBehindQueue: %i pending updates lost"), Pending.Num());
+    }
+}
+
+bool FDataWriteBehindQueue::Update(UObject* const Obj)
+{
+    check(Obj);
+    
+    int32 Id = GetId(Obj);
+    if(Id <= 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Update: %s has no Id, create the record before queueing updates"), *Obj->GetName());
+        return false;
+    }
+    
+    Pending.Add(FPendingKey(Obj->GetClass(), Id), Obj);
+    return true;
+}
+
+void FDataWriteBehindQueue::Discard(UObject* const Obj)
+{
+    check(Obj);
+    Pending.Remove(FPendingKey(Obj->GetClass(), GetId(Obj)));
+}
+
+bool FDataWriteBehindQueue::Flush()
+{
+    if(Pending.Num() == 0)
+    {
+        return true;
+    }
+    
+    TMap<UClass*, TArray<UObject*>> Batches;
+    for(auto Itr = Pending.CreateConstIterator(); Itr; ++Itr)
+    {
+        Batches.FindOrAdd(Itr.Key().Class).Add(Itr.Value());
+    }
+    
+    if(!DataHandler->BeginTransaction(EDataTransactionMode::Immediate))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Flush: cannot begin transaction, %i updates stay queued"), Pending.Num());
+        return false;
+    }
+    
+    // Records deleted while their update was queued, e.g. of destroyed entities, are dropped rather than failing the flush
+    int32 Dropped = 0;
+    for(auto Itr = Batches.CreateConstIterator(); Itr; ++Itr)
+    {
+        TArray<UObject*> Missing;
+        if(DataHandler->Source(Itr.Key()).UpdateMany(Itr.Value(), Missing))
+        {
+            Dropped += Missing.Num();
+        }
+        else
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("Flush: cannot update %s records, %i updates stay queued"), *Itr.Key()->GetName(), Pending.Num());
+            DataHandler->Rollback();
+            return false;
+        }
+    }
+    
+    if(!DataHandler->Commit())
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Flush: cannot commit, %i updates stay queued"), Pending.Num());
+        DataHandler->Rollback();
+        return false;
+    }
+    
+    if(Dropped > 0)
+    {
+        UE_LOG(LogDataAccess, Log, TEXT("Flush: dropped %i updates of records that no longer exist"), Dropped);
+    }
+    
+    Pending.Empty();
+    return true;
+}
+
+int32 FDataWriteBehindQueue::Num() const
+{
+    return Pending.Num();
+}
+
+void FDataWriteBehindQueue::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    for(auto Itr = Pending.CreateIterator(); Itr; ++Itr)
+    {
+        Collector.AddReferencedObject(Itr.Value());
+    }
+}
+
+bool FDataWriteBehindQueue::Tick(float DeltaTime)
+{
+    Flush();
+    return true;
+}
+
+int32 FDataWriteBehindQueue::GetId(UObject* const Obj)
+{
+    return FindFieldChecked<UIntProperty>(Obj->GetClass(), "Id")->GetPropertyValue_InContainer(Obj);
+}
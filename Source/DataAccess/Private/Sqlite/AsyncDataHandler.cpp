@@ -0,0 +1,330 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteDataResource.h"
+#include "SqliteDataHandler.h"
+#include "SqliteClassSchema.h"
+#include "AsyncDataHandler.h"
+#include "TaskGraphInterfaces.h"
+
+namespace AsyncDataHandlerHelpers
+{
+    TArray<UObject*> SingleObject(UObject* Obj)
+    {
+        TArray<UObject*> Objects;
+        Objects.Add(Obj);
+        return Objects;
+    }
+
+    TArray<UObject*> JoinObjects(const TArray<UObject*>& First, const TArray<UObject*>& Second)
+    {
+        TArray<UObject*> Objects(First);
+        Objects.Append(Second);
+        return Objects;
+    }
+
+    /**
+     * Copy the persisted properties of objects into objects of the same class
+     *
+     * @param   Dests               objects to copy into
+     * @param   Srcs                objects to copy from, one per Dests entry
+     * @param   bGeneratedOnly      only copy the Id and timestamps written by the database
+     */
+    void CopyColumns(const TArray<UObject*>& Dests, const TArray<UObject*>& Srcs, bool bGeneratedOnly)
+    {
+        check(Dests.Num() == Srcs.Num());
+        for(int32 i = 0; i < Srcs.Num(); ++i)
+        {
+            FSqliteClassSchemaRef Schema = FSqliteClassSchema::Get(Srcs[i]->GetClass());
+            for(const FSqliteColumn& Column : Schema->Columns)
+            {
+                if(!bGeneratedOnly || Column.bGenerated)
+                {
+                    Column.Property->CopyCompleteValue(Column.GetValuePtr(Dests[i]), Column.GetValuePtr(Srcs[i]));
+                }
+            }
+        }
+    }
+
+    /**
+     * Create private copies of objects for the database thread to work on.  Must be called on the game thread.
+     *
+     * @param   Objs                objects to copy
+     * @param   bCopyValues         copy the persisted properties, otherwise the copies keep their defaults
+     * @return                      one copy per object
+     */
+    TArray<UObject*> CopyForCommand(const TArray<UObject*>& Objs, bool bCopyValues)
+    {
+        check(IsInGameThread());
+
+        TArray<UObject*> Copies;
+        Copies.Reserve(Objs.Num());
+        for(UObject* Obj : Objs)
+        {
+            check(Obj);
+            Copies.Add(NewObject<UObject>(GetTransientPackage(), Obj->GetClass(), NAME_None, RF_Transient));
+        }
+
+        if(bCopyValues)
+        {
+            CopyColumns(Copies, Objs, false);
+        }
+        return Copies;
+    }
+}
+
+FAsyncDataHandler::FAsyncDataHandler(FString DatabaseFileLocation)
+: DatabaseFileLocation(DatabaseFileLocation)
+, WorkEvent(FPlatformProcess::CreateSynchEvent(false))
+, Thread(nullptr)
+, InFlightObjects(MakeShareable(new FInFlightObjects()))
+{
+    Thread = FRunnableThread::Create(this, TEXT("DataAccessDatabaseThread"), 0, TPri_Normal);
+}
+
+FAsyncDataHandler::~FAsyncDataHandler()
+{
+    if(Thread)
+    {
+        // Run drains the queue before it returns
+        Stop();
+        Thread->WaitForCompletion();
+        delete Thread;
+        Thread = nullptr;
+    }
+    
+    delete WorkEvent;
+    WorkEvent = nullptr;
+}
+
+TFuture<bool> FAsyncDataHandler::Enqueue(FDataCommand Command, const TArray<UObject*>& Objects)
+{
+    FQueuedCommand* QueuedCommand = new FQueuedCommand();
+    QueuedCommand->Command = MoveTemp(Command);
+    QueuedCommand->Objects = Objects;
+    
+    TFuture<bool> Future = QueuedCommand->Promise.GetFuture();
+    QueueCommand(QueuedCommand);
+    return Future;
+}
+
+void FAsyncDataHandler::Enqueue(FDataCommand Command, FDataCommandCallback Callback, const TArray<UObject*>& Objects)
+{
+    check(Callback);
+    
+    FQueuedCommand* QueuedCommand = new FQueuedCommand();
+    QueuedCommand->Command = MoveTemp(Command);
+    QueuedCommand->Callback = MoveTemp(Callback);
+    QueuedCommand->Objects = Objects;
+    QueueCommand(QueuedCommand);
+}
+
+TFuture<bool> FAsyncDataHandler::Create(UObject* Obj)
+{
+    check(Obj);
+    
+    TArray<UObject*> Objs = AsyncDataHandlerHelpers::SingleObject(Obj);
+    TArray<UObject*> Copies = AsyncDataHandlerHelpers::CopyForCommand(Objs, true);
+    UObject* Copy = Copies[0];
+    return EnqueueWithResults([Copy](IDataHandler& DataHandler) { return DataHandler.Source(Copy->GetClass()).Create(Copy); },
+                              [Objs, Copies]() { AsyncDataHandlerHelpers::CopyColumns(Objs, Copies, true); },
+                              AsyncDataHandlerHelpers::JoinObjects(Objs, Copies));
+}
+
+TFuture<bool> FAsyncDataHandler::CreateMany(const TArray<UObject*>& Objs)
+{
+    if(Objs.Num() == 0)
+    {
+        return Enqueue([](IDataHandler& DataHandler) { return true; });
+    }
+    
+    UClass* Class = Objs[0]->GetClass();
+    TArray<UObject*> Copies = AsyncDataHandlerHelpers::CopyForCommand(Objs, true);
+    return EnqueueWithResults([Class, Copies](IDataHandler& DataHandler) { return DataHandler.Source(Class).CreateMany(Copies); },
+                              [Objs, Copies]() { AsyncDataHandlerHelpers::CopyColumns(Objs, Copies, true); },
+                              AsyncDataHandlerHelpers::JoinObjects(Objs, Copies));
+}
+
+TFuture<bool> FAsyncDataHandler::Update(UObject* Obj)
+{
+    check(Obj);
+    return UpdateMany(AsyncDataHandlerHelpers::SingleObject(Obj));
+}
+
+TFuture<bool> FAsyncDataHandler::UpdateMany(const TArray<UObject*>& Objs)
+{
+    if(Objs.Num() == 0)
+    {
+        return Enqueue([](IDataHandler& DataHandler) { return true; });
+    }
+    
+    UClass* Class = Objs[0]->GetClass();
+    TArray<UObject*> Copies = AsyncDataHandlerHelpers::CopyForCommand(Objs, true);
+    return EnqueueWithResults([Class, Copies](IDataHandler& DataHandler) { return DataHandler.Source(Class).UpdateMany(Copies); },
+                              [Objs, Copies]() { AsyncDataHandlerHelpers::CopyColumns(Objs, Copies, true); },
+                              AsyncDataHandlerHelpers::JoinObjects(Objs, Copies));
+}
+
+TFuture<bool> FAsyncDataHandler::First(UObject* OutObj, int32 Id)
+{
+    check(OutObj);
+    
+    TArray<UObject*> Objs = AsyncDataHandlerHelpers::SingleObject(OutObj);
+    TArray<UObject*> Copies = AsyncDataHandlerHelpers::CopyForCommand(Objs, false);
+    UObject* Copy = Copies[0];
+    return EnqueueWithResults([Copy, Id](IDataHandler& DataHandler) { return DataHandler.Source(Copy->GetClass()).Where("Id", EDataHandlerOperator::Equals, Id).First(Copy); },
+                              [Objs, Copies]() { AsyncDataHandlerHelpers::CopyColumns(Objs, Copies, false); },
+                              AsyncDataHandlerHelpers::JoinObjects(Objs, Copies));
+}
+
+TFuture<bool> FAsyncDataHandler::Delete(UObject* Obj)
+{
+    check(Obj);
+    
+    // Read the Id now, the object may change before the command runs
+    UClass* Class = Obj->GetClass();
+    int32 Id = FindFieldChecked<UIntProperty>(Class, "Id")->GetPropertyValue_InContainer(Obj);
+    return Enqueue([Class, Id](IDataHandler& DataHandler) { return DataHandler.Source(Class).Where("Id", EDataHandlerOperator::Equals, Id).Delete(); });
+}
+
+void FAsyncDataHandler::Flush()
+{
+    Enqueue([](IDataHandler& DataHandler) { return true; }).Wait();
+    
+    // Earlier commands dispatched their results and callbacks to the game thread before the no-op completed
+    if(IsInGameThread())
+    {
+        FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+    }
+}
+
+uint32 FAsyncDataHandler::Run()
+{
+    // The connection is opened, used and closed on this thread only
+    DataResource = MakeShareable(new SqliteDataResource(DatabaseFileLocation));
+    if(DataResource->Acquire())
+    {
+        DataHandler = MakeShareable(new SqliteDataHandler(DataResource));
+    }
+    else
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("FAsyncDataHandler: cannot acquire %s, every command will fail"), *DatabaseFileLocation);
+    }
+    
+    while(StopCounter.GetValue() == 0)
+    {
+        ProcessCommands();
+        WorkEvent->Wait();
+    }
+    ProcessCommands();
+    
+    DataHandler.Reset();
+    DataResource->Release();
+    DataResource.Reset();
+    return 0;
+}
+
+void FAsyncDataHandler::Stop()
+{
+    StopCounter.Increment();
+    WorkEvent->Trigger();
+}
+
+void FAsyncDataHandler::AddReferencedObjects(FReferenceCollector& Collector)
+{
+    FScopeLock Lock(&InFlightObjects->Lock);
+    for(auto Itr = InFlightObjects->Counts.CreateIterator(); Itr; ++Itr)
+    {
+        Collector.AddReferencedObject(Itr.Key());
+    }
+}
+
+TFuture<bool> FAsyncDataHandler::EnqueueWithResults(FDataCommand Command, FDataCommandApply Apply, const TArray<UObject*>& Objects)
+{
+    FQueuedCommand* QueuedCommand = new FQueuedCommand();
+    QueuedCommand->Command = MoveTemp(Command);
+    QueuedCommand->Apply = MoveTemp(Apply);
+    QueuedCommand->Objects = Objects;
+    
+    TFuture<bool> Future = QueuedCommand->Promise.GetFuture();
+    QueueCommand(QueuedCommand);
+    return Future;
+}
+
+void FAsyncDataHandler::QueueCommand(FQueuedCommand* QueuedCommand)
+{
+    if(StopCounter.GetValue() != 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("FAsyncDataHandler: command queued while stopping"));
+        CompleteCommand(QueuedCommand, false);
+        return;
+    }
+    
+    InFlightObjects->Add(QueuedCommand->Objects);
+    Commands.Enqueue(QueuedCommand);
+    WorkEvent->Trigger();
+}
+
+void FAsyncDataHandler::ProcessCommands()
+{
+    FQueuedCommand* QueuedCommand = nullptr;
+    while(Commands.Dequeue(QueuedCommand))
+    {
+        bool bSuccess = DataHandler.IsValid() && QueuedCommand->Command(*DataHandler);
+        CompleteCommand(QueuedCommand, bSuccess);
+    }
+}
+
+void FAsyncDataHandler::CompleteCommand(FQueuedCommand* QueuedCommand, bool bSuccess)
+{
+    if(!QueuedCommand->Apply && !QueuedCommand->Callback)
+    {
+        InFlightObjects->Remove(QueuedCommand->Objects);
+        QueuedCommand->Promise.SetValue(bSuccess);
+        delete QueuedCommand;
+        return;
+    }
+    
+    // Results and callbacks touch the caller's objects, so they run on the game thread.  The objects stay referenced until then.
+    TSharedRef<FInFlightObjects, ESPMode::ThreadSafe> InFlight = InFlightObjects;
+    FFunctionGraphTask::CreateAndDispatchWhenReady([QueuedCommand, InFlight, bSuccess]()
+    {
+        if(bSuccess && QueuedCommand->Apply)
+        {
+            QueuedCommand->Apply();
+        }
+        
+        if(QueuedCommand->Callback)
+        {
+            QueuedCommand->Callback(bSuccess);
+        }
+        else
+        {
+            QueuedCommand->Promise.SetValue(bSuccess);
+        }
+        
+        InFlight->Remove(QueuedCommand->Objects);
+        delete QueuedCommand;
+    }, TStatId(), nullptr, ENamedThreads::GameThread);
+}
+
+void FAsyncDataHandler::FInFlightObjects::Add(const TArray<UObject*>& Objects)
+{
+    FScopeLock ScopeLock(&Lock);
+    for(UObject* Obj : Objects)
+    {
+        ++Counts.FindOrAdd(Obj);
+    }
+}
+
+void FAsyncDataHandler::FInFlightObjects::Remove(const TArray<UObject*>& Objects)
+{
+    FScopeLock ScopeLock(&Lock);
+    for(UObject* Obj : Objects)
+    {
+        int32* Count = Counts.Find(Obj);
+        if(Count && --(*Count) <= 0)
+        {
+            Counts.Remove(Obj);
+        }
+    }
+}
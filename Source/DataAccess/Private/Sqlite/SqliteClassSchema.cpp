@@ -0,0 +1,503 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteClassSchema.h"
+#include "SqliteScratchArena.h"
+#include "DataAccessStats.h"
+
+namespace SqliteColumnFunctions
+{
+    template<typename T>
+    int32 BindInt(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FSqliteColumn& Column, const void* ValuePtr, FSqliteScratchArena& Scratch)
+    {
+        return sqlite3_bind_int(SqliteStatement, ParameterIndex, *static_cast<const T*>(ValuePtr));
+    }
+
+    template<typename T>
+    int32 BindInt64(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FSqliteColumn& Column, const void* ValuePtr, FSqliteScratchArena& Scratch)
+    {
+        return sqlite3_bind_int64(SqliteStatement, ParameterIndex, *static_cast<const T*>(ValuePtr));
+    }
+
+    template<typename T>
+    int32 BindDouble(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FSqliteColumn& Column, const void* ValuePtr, FSqliteScratchArena& Scratch)
+    {
+        return sqlite3_bind_double(SqliteStatement, ParameterIndex, *static_cast<const T*>(ValuePtr));
+    }
+
+    int32 BindBool(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FSqliteColumn& Column, const void* ValuePtr, FSqliteScratchArena& Scratch)
+    {
+        // Bool properties can be bitfields, let the property apply its mask
+        return sqlite3_bind_int(SqliteStatement, ParameterIndex, static_cast<UBoolProperty*>(Column.Property)->GetPropertyValue(ValuePtr));
+    }
+
+    int32 BindString(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FSqliteColumn& Column, const void* ValuePtr, FSqliteScratchArena& Scratch)
+    {
+        int32 ByteCount;
+        const ANSICHAR* Utf8 = Scratch.ToUtf8(*static_cast<const FString*>(ValuePtr), ByteCount);
+        return sqlite3_bind_text(SqliteStatement, ParameterIndex, Utf8, ByteCount, SQLITE_STATIC);
+    }
+
+    int32 BindArray(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FSqliteColumn& Column, const void* ValuePtr, FSqliteScratchArena& Scratch)
+    {
+        // The bound object outlives the step and every statement is reset and unbound before it is handed out again,
+        // so sqlite can read the array memory in place instead of copying it
+        UArrayProperty* ArrayProperty = static_cast<UArrayProperty*>(Column.Property);
+        FScriptArrayHelper ArrayHelper(ArrayProperty, ValuePtr);
+        return sqlite3_bind_blob(SqliteStatement, ParameterIndex, ArrayHelper.GetRawPtr(), ArrayHelper.Num() * ArrayProperty->Inner->ElementSize, SQLITE_STATIC);
+    }
+
+    template<typename T>
+    void ReadInt(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex, const FSqliteColumn& Column, void* ValuePtr)
+    {
+        *static_cast<T*>(ValuePtr) = static_cast<T>(sqlite3_column_int(SqliteStatement, ColumnIndex));
+    }
+
+    template<typename T>
+    void ReadInt64(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex, const FSqliteColumn& Column, void* ValuePtr)
+    {
+        *static_cast<T*>(ValuePtr) = static_cast<T>(sqlite3_column_int64(SqliteStatement, ColumnIndex));
+    }
+
+    template<typename T>
+    void ReadDouble(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex, const FSqliteColumn& Column, void* ValuePtr)
+    {
+        *static_cast<T*>(ValuePtr) = static_cast<T>(sqlite3_column_double(SqliteStatement, ColumnIndex));
+    }
+
+    void ReadBool(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex, const FSqliteColumn& Column, void* ValuePtr)
+    {
+        static_cast<UBoolProperty*>(Column.Property)->SetPropertyValue(ValuePtr, sqlite3_column_int(SqliteStatement, ColumnIndex) != 0);
+    }
+
+    void ReadString(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex, const FSqliteColumn& Column, void* ValuePtr)
+    {
+        *static_cast<FString*>(ValuePtr) = UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, ColumnIndex));
+    }
+
+    void ReadArray(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex, const FSqliteColumn& Column, void* ValuePtr)
+    {
+        UArrayProperty* ArrayProperty = static_cast<UArrayProperty*>(Column.Property);
+        const void* Src = sqlite3_column_blob(SqliteStatement, ColumnIndex);
+        const int32 ElementSize = ArrayProperty->Inner->ElementSize;
+        const int32 ElementCount = sqlite3_column_bytes(SqliteStatement, ColumnIndex) / ElementSize;
+
+        // Size the array once and copy the blob straight into it, elements are plain old data
+        FScriptArrayHelper ArrayHelper(ArrayProperty, ValuePtr);
+        ArrayHelper.EmptyAndAddUninitializedValues(ElementCount);
+        if(ElementCount > 0)
+        {
+            FMemory::Memcpy(ArrayHelper.GetRawPtr(), Src, ElementCount * ElementSize);
+        }
+    }
+
+    void DestroyPlainOldData(void* ValuePtr)
+    {
+    }
+
+    void DestroyString(void* ValuePtr)
+    {
+        static_cast<FString*>(ValuePtr)->~FString();
+    }
+
+    void DestroyArray(void* ValuePtr)
+    {
+        // Elements are plain old data, only the allocation has to go
+        static_cast<FScriptArray*>(ValuePtr)->~FScriptArray();
+    }
+
+    /**
+     * Resolve the bind, read and destroy functions for a property once, instead of walking the IsA chain per row
+     */
+    void Resolve(UProperty* Property, FSqliteBindColumnFunc& OutBind, FSqliteReadColumnFunc& OutRead, FSqliteDestroyColumnFunc& OutDestroy, const TCHAR*& OutSqlType)
+    {
+        OutBind = nullptr;
+        OutRead = nullptr;
+        OutDestroy = nullptr;
+        OutSqlType = nullptr;
+
+        if(Property->IsA(UByteProperty::StaticClass()))
+        {
+            OutBind = &BindInt<uint8>;
+            OutRead = &ReadInt<uint8>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UInt8Property::StaticClass()))
+        {
+            OutBind = &BindInt<int8>;
+            OutRead = &ReadInt<int8>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UInt16Property::StaticClass()))
+        {
+            OutBind = &BindInt<int16>;
+            OutRead = &ReadInt<int16>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UIntProperty::StaticClass()))
+        {
+            OutBind = &BindInt<int32>;
+            OutRead = &ReadInt<int32>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UInt64Property::StaticClass()))
+        {
+            OutBind = &BindInt64<int64>;
+            OutRead = &ReadInt64<int64>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UUInt16Property::StaticClass()))
+        {
+            OutBind = &BindInt<uint16>;
+            OutRead = &ReadInt<uint16>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UUInt32Property::StaticClass()))
+        {
+            OutBind = &BindInt<uint32>;
+            OutRead = &ReadInt<uint32>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UUInt64Property::StaticClass()))
+        {
+            OutBind = &BindInt64<uint64>;
+            OutRead = &ReadInt64<uint64>;
+            OutSqlType = TEXT("INTEGER");
+        }
+        else if(Property->IsA(UFloatProperty::StaticClass()))
+        {
+            OutBind = &BindDouble<float>;
+            OutRead = &ReadDouble<float>;
+            OutSqlType = TEXT("REAL");
+        }
+        else if(Property->IsA(UDoubleProperty::StaticClass()))
+        {
+            OutBind = &BindDouble<double>;
+            OutRead = &ReadDouble<double>;
+            OutSqlType = TEXT("REAL");
+        }
+        else if(Property->IsA(UBoolProperty::StaticClass()))
+        {
+            OutBind = &BindBool;
+            OutRead = &ReadBool;
+            OutSqlType = TEXT("NUMERIC");
+        }
+        else if(Property->IsA(UStrProperty::StaticClass()))
+        {
+            OutBind = &BindString;
+            OutRead = &ReadString;
+            OutDestroy = &DestroyString;
+            OutSqlType = TEXT("TEXT");
+        }
+        else if(Property->IsA(UArrayProperty::StaticClass()) && (static_cast<UArrayProperty*>(Property)->Inner->PropertyFlags & CPF_IsPlainOldData))
+        {
+            // Arrays are stored as their raw bytes, which only round trips for plain old data elements
+            OutBind = &BindArray;
+            OutRead = &ReadArray;
+            OutDestroy = &DestroyArray;
+            OutSqlType = TEXT("BLOB");
+        }
+        
+        if(OutBind && !OutDestroy)
+        {
+            OutDestroy = &DestroyPlainOldData;
+        }
+    }
+}
+
+FSqliteClassSchemaRef FSqliteClassSchema::Get(UClass* Class)
+{
+    check(Class);
+
+    // Weak keys never match a class that was garbage collected or replaced by a hot reload, even at the same address
+    static FCriticalSection SchemaLock;
+    static TMap<TWeakObjectPtr<UClass>, FSqliteClassSchemaRef> Schemas;
+
+    FScopeLock Lock(&SchemaLock);
+    const FSqliteClassSchemaRef* Found = Schemas.Find(Class);
+    if(Found)
+    {
+        return *Found;
+    }
+
+    // Misses are rare, drop the schemas of classes that are gone while here
+    for(auto Itr = Schemas.CreateIterator(); Itr; ++Itr)
+    {
+        if(!Itr.Key().IsValid())
+        {
+            Itr.RemoveCurrent();
+        }
+    }
+
+    FSqliteClassSchemaRef NewSchema = MakeShareable(new FSqliteClassSchema(Class));
+    Schemas.Add(Class, NewSchema);
+    return NewSchema;
+}
+
+int32 FSqliteColumn::GetValueSize(const void* ValuePtr) const
+{
+    if(Property->IsA(UStrProperty::StaticClass()))
+    {
+        return static_cast<const FString*>(ValuePtr)->Len();
+    }
+
+    if(Property->IsA(UArrayProperty::StaticClass()))
+    {
+        UArrayProperty* ArrayProperty = static_cast<UArrayProperty*>(Property);
+        FScriptArrayHelper ArrayHelper(ArrayProperty, ValuePtr);
+        return ArrayHelper.Num() * ArrayProperty->Inner->ElementSize;
+    }
+
+    return Property->ElementSize;
+}
+
+FDataValue FSqliteColumn::GetValue(const void* ValuePtr) const
+{
+    if(Property->IsA(UBoolProperty::StaticClass()))
+    {
+        return FDataValue(static_cast<UBoolProperty*>(Property)->GetPropertyValue(ValuePtr));
+    }
+
+    if(Property->IsA(UStrProperty::StaticClass()))
+    {
+        return FDataValue(*static_cast<const FString*>(ValuePtr));
+    }
+
+    if(Property->IsA(UUInt64Property::StaticClass()))
+    {
+        return FDataValue(*static_cast<const uint64*>(ValuePtr));
+    }
+
+    if(Property->IsA(UNumericProperty::StaticClass()))
+    {
+        UNumericProperty* NumericProperty = static_cast<UNumericProperty*>(Property);
+        return NumericProperty->IsFloatingPoint() ? FDataValue(NumericProperty->GetFloatingPointPropertyValue(ValuePtr)) : FDataValue(NumericProperty->GetSignedIntPropertyValue(ValuePtr));
+    }
+
+    return FDataValue();
+}
+
+int32 FSqliteClassSchema::FindColumn(const FString& Name) const
+{
+    const int32* Found = ColumnIndices.Find(Name);
+    return Found ? *Found : INDEX_NONE;
+}
+
+bool FSqliteClassSchema::ReadRow(sqlite3_stmt* const SqliteStatement, void* Container, uint64 ColumnMask) const
+{
+    DATAACCESS_SCOPE_PHASE(Decode);
+    check(SqliteStatement);
+
+    int32 ColumnIndex = 0;
+    bool bSuccess = true;
+    int64 RowBytes = 0;
+
+    // The select is built off the same schema, so the result columns are in schema order
+    for(int32 i = 0; i < Columns.Num(); ++i)
+    {
+        if(ColumnMask && (i >= 64 || !(ColumnMask & (1ull << i))))
+        {
+            continue;
+        }
+
+        const FSqliteColumn& Column = Columns[i];
+        if(!Column.Read)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("BindParameters: Data type on UPROPERTY() %s is not supported"), *(Column.Name));
+            bSuccess = false;
+        }
+        else
+        {
+            Column.Read(SqliteStatement, ColumnIndex, Column, Column.GetValuePtr(Container));
+#if DATAACCESS_METRICS
+            // Asking numeric values for their byte count would convert them to text, so they count as their storage size
+            int32 ColumnType = sqlite3_column_type(SqliteStatement, ColumnIndex);
+            RowBytes += ColumnType == SQLITE_TEXT || ColumnType == SQLITE_BLOB ? sqlite3_column_bytes(SqliteStatement, ColumnIndex) : ColumnType == SQLITE_NULL ? 0 : 8;
+#endif
+        }
+        ++ColumnIndex;
+    }
+
+    DATAACCESS_INC_COUNTER(RowsRead, 1);
+    DATAACCESS_INC_COUNTER(BytesRead, RowBytes);
+    return bSuccess;
+}
+
+FString FSqliteClassSchema::BuildSelectColumnList(uint64 ColumnMask) const
+{
+    FString ColumnList;
+    for(int32 i = 0; i < Columns.Num() && i < 64; ++i)
+    {
+        if(ColumnMask & (1ull << i))
+        {
+            ColumnList += FString::Printf(TEXT("%s,"), *(Columns[i].Name));
+        }
+    }
+
+    ColumnList.RemoveFromEnd(",", ESearchCase::IgnoreCase);
+    return ColumnList;
+}
+
+FString FSqliteClassSchema::BuildUpdateSetList(uint64 ColumnMask, bool bSetTimestamp) const
+{
+    FString SetList;
+    for(int32 i = 0; i < WritableColumns.Num() && i < 64; ++i)
+    {
+        if(ColumnMask & (1ull << i))
+        {
+            SetList += FString::Printf(TEXT("%s = ?,"), *(Columns[WritableColumns[i]].Name));
+        }
+    }
+
+    if(bSetTimestamp)
+    {
+        SetList += "LastUpdateTimestamp = strftime('%s','now'),";
+    }
+
+    SetList.RemoveFromEnd(",", ESearchCase::IgnoreCase);
+    return SetList;
+}
+
+FSqliteClassSchema::FSqliteClassSchema(UClass* Class)
+: Class(Class)
+, TableName(Class->GetName())
+, IdProperty(FindFieldChecked<UIntProperty>(Class, "Id"))
+, CreateTimestampProperty(FindField<UIntProperty>(Class, "CreateTimestamp"))
+, LastUpdateTimestampProperty(FindField<UIntProperty>(Class, "LastUpdateTimestamp"))
+{
+    for(TFieldIterator<UProperty> Itr(Class); Itr; ++Itr)
+    {
+        UProperty* Property = *Itr;
+
+        // All properties to save to the database require the SaveToDatabase attribute
+        if(!Property->HasMetaData("SaveToDatabase") || !Property->GetMetaData("SaveToDatabase").ToUpper().Equals("TRUE"))
+        {
+            continue;
+        }
+
+        FSqliteColumn Column;
+        Column.Name = Property->GetName();
+        Column.Property = Property;
+        Column.Offset = Property->GetOffset_ReplaceWith_ContainerPtrToValuePtr();
+        Column.bGenerated = Column.Name == "Id" || Column.Name == "CreateTimestamp" || Column.Name == "LastUpdateTimestamp";
+        SqliteColumnFunctions::Resolve(Property, Column.Bind, Column.Read, Column.Destroy, Column.SqlType);
+        Column.bIndexed = Property->HasMetaData("DatabaseIndex") && Property->GetMetaData("DatabaseIndex").ToUpper().Equals("TRUE");
+        Column.bUnique = Property->HasMetaData("DatabaseUnique") && Property->GetMetaData("DatabaseUnique").ToUpper().Equals("TRUE");
+
+        int32 ColumnIndex = Columns.Add(Column);
+        ColumnIndices.Add(Column.Name, ColumnIndex);
+
+        if(Column.bIndexed || Column.bUnique)
+        {
+            FSqliteIndex Index;
+            Index.Name = FString::Printf(TEXT("%s_%s_%s"), *TableName, *(Column.Name), Column.bUnique ? TEXT("Unique") : TEXT("Index"));
+            Index.Columns.Add(Column.Name);
+            Index.bUnique = Column.bUnique;
+            Indexes.Add(Index);
+        }
+
+        SelectColumnList += FString::Printf(TEXT("%s,"), *(Column.Name));
+
+        if(Column.bGenerated)
+        {
+            continue;
+        }
+
+        WritableColumns.Add(ColumnIndex);
+        InsertColumnList += FString::Printf(TEXT("%s,"), *(Column.Name));
+        InsertValueList += "?,";
+        UpdateSetList += FString::Printf(TEXT("%s = ?,"), *(Column.Name));
+    }
+
+    SelectColumnList.RemoveFromEnd(",", ESearchCase::IgnoreCase);
+    InsertColumnList.RemoveFromEnd(",", ESearchCase::IgnoreCase);
+    InsertValueList.RemoveFromEnd(",", ESearchCase::IgnoreCase);
+    UpdateSetList.RemoveFromEnd(",", ESearchCase::IgnoreCase);
+    InsertReturningColumnList = InsertColumnList.IsEmpty() ? "(CreateTimestamp,LastUpdateTimestamp)" : "(" + InsertColumnList + ",CreateTimestamp,LastUpdateTimestamp)";
+    InsertReturningValueList = InsertValueList.IsEmpty() ? "(strftime('%s','now'),strftime('%s','now'))" : "(" + InsertValueList + ",strftime('%s','now'),strftime('%s','now'))";
+    UpdateReturningSetList = UpdateSetList.IsEmpty() ? "LastUpdateTimestamp = strftime('%s','now')" : UpdateSetList + ",LastUpdateTimestamp = strftime('%s','now')";
+    InsertColumnList = "(" + InsertColumnList + ")";
+    InsertValueList = "(" + InsertValueList + ")";
+
+    if(Class->HasMetaData("DatabaseIndex"))
+    {
+        AddClassIndexes(Class->GetMetaData("DatabaseIndex"), false);
+    }
+    if(Class->HasMetaData("DatabaseUnique"))
+    {
+        AddClassIndexes(Class->GetMetaData("DatabaseUnique"), true);
+    }
+}
+
+void FSqliteClassSchema::AddClassIndexes(const FString& Declaration, bool bUnique)
+{
+    TArray<FString> IndexDeclarations;
+    Declaration.ParseIntoArray(&IndexDeclarations, TEXT(";"), true);
+
+    for(const FString& IndexDeclaration : IndexDeclarations)
+    {
+        TArray<FString> ColumnNames;
+        IndexDeclaration.ParseIntoArray(&ColumnNames, TEXT(","), true);
+
+        FSqliteIndex Index;
+        Index.bUnique = bUnique;
+        for(FString ColumnName : ColumnNames)
+        {
+            ColumnName = ColumnName.Trim().TrimTrailing();
+            if(FindColumn(ColumnName) == INDEX_NONE)
+            {
+                UE_LOG(LogDataAccess, Error, TEXT("FSqliteClassSchema: index column \"%s\" is not saved to the database in UClass \"%s\".  Index not added"), *ColumnName, *TableName);
+                Index.Columns.Empty();
+                break;
+            }
+            Index.Columns.Add(ColumnName);
+        }
+
+        if(Index.Columns.Num() == 0)
+        {
+            continue;
+        }
+
+        Index.Name = FString::Printf(TEXT("%s_%s_%s"), *TableName, *FString::Join(Index.Columns, TEXT("_")), bUnique ? TEXT("Unique") : TEXT("Index"));
+        Indexes.Add(Index);
+    }
+}
+
+FString FSqliteClassSchema::BuildCreateTableSql() const
+{
+    FString ColumnDefinitions;
+    for(const FSqliteColumn& Column : Columns)
+    {
+        if(Column.Name == "Id")
+        {
+            ColumnDefinitions += "Id INTEGER PRIMARY KEY AUTOINCREMENT,";
+        }
+        else if(Column.SqlType)
+        {
+            ColumnDefinitions += FString::Printf(TEXT("%s %s,"), *(Column.Name), Column.SqlType);
+        }
+        else
+        {
+            UE_LOG(LogDataAccess, Warning, TEXT("BuildCreateTableSql: Data type on UPROPERTY() %s is not supported, column not created"), *(Column.Name));
+        }
+    }
+    ColumnDefinitions.RemoveFromEnd(",", ESearchCase::IgnoreCase);
+
+    return FString::Printf(TEXT("CREATE TABLE IF NOT EXISTS %s (%s);"), *TableName, *ColumnDefinitions);
+}
+
+void FSqliteClassSchema::BuildSupportSql(TArray<FString>& OutStatements) const
+{
+    OutStatements.Empty();
+
+    // Same triggers the README asks for when creating tables by hand
+    if(CreateTimestampProperty && LastUpdateTimestampProperty)
+    {
+        OutStatements.Add(FString::Printf(TEXT("CREATE TRIGGER IF NOT EXISTS %s_Insert AFTER INSERT ON %s BEGIN UPDATE %s SET CreateTimestamp = strftime('%%s','now'), LastUpdateTimestamp = strftime('%%s','now') WHERE Id = new.Id; END;"), *TableName, *TableName, *TableName));
+        OutStatements.Add(FString::Printf(TEXT("CREATE TRIGGER IF NOT EXISTS %s_Update AFTER UPDATE ON %s FOR EACH ROW BEGIN UPDATE %s SET LastUpdateTimestamp = strftime('%%s','now') WHERE Id = new.Id; END;"), *TableName, *TableName, *TableName));
+    }
+
+    for(const FSqliteIndex& Index : Indexes)
+    {
+        OutStatements.Add(FString::Printf(TEXT("CREATE %sINDEX IF NOT EXISTS %s ON %s (%s);"), Index.bUnique ? TEXT("UNIQUE ") : TEXT(""), *(Index.Name), *TableName, *FString::Join(Index.Columns, TEXT(","))));
+    }
+}
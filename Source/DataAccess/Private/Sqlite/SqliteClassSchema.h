@@ -0,0 +1,214 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+#include "DataValue.h"
+
+typedef struct sqlite3_stmt sqlite3_stmt;
+
+struct FSqliteColumn;
+class FSqliteScratchArena;
+
+/**
+ * Binds the value of a column to a prepared statement parameter
+ *
+ * @param   SqliteStatement     statement to bind to
+ * @param   ParameterIndex      1 based parameter index
+ * @param   Column              column being bound
+ * @param   ValuePtr            pointer to the property value.  Arrays are bound in place, so it must outlive the step.
+ * @param   Scratch             arena text is converted into, must not be reset before the statement is stepped
+ * @return                      sqlite result code
+ */
+typedef int32 (*FSqliteBindColumnFunc)(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FSqliteColumn& Column, const void* ValuePtr, FSqliteScratchArena& Scratch);
+
+/**
+ * Reads a result column of a stepped statement into a property value
+ *
+ * @param   SqliteStatement     statement to read from
+ * @param   ColumnIndex         0 based result column index
+ * @param   Column              column being read
+ * @param   ValuePtr            pointer to the property value
+ */
+typedef void (*FSqliteReadColumnFunc)(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex, const FSqliteColumn& Column, void* ValuePtr);
+
+/**
+ * Destroys a property value without going through the property, so copies of values can outlive their class
+ *
+ * @param   ValuePtr            pointer to the property value
+ */
+typedef void (*FSqliteDestroyColumnFunc)(void* ValuePtr);
+
+/**
+ * A single persisted property of a class
+ */
+struct FSqliteColumn
+{
+    /** Column name, same as the property name */
+    FString Name;
+
+    /** Reflected property backing this column */
+    UProperty* Property;
+
+    /** Offset of the property value inside of its container */
+    int32 Offset;
+
+    /** Id, CreateTimestamp and LastUpdateTimestamp are written by the database and never bound */
+    bool bGenerated;
+
+    /** Pre-resolved bind, read and destroy functions.  nullptr if the property type is not supported */
+    FSqliteBindColumnFunc Bind;
+    FSqliteReadColumnFunc Read;
+    FSqliteDestroyColumnFunc Destroy;
+
+    /** Declared column type used when generating the table.  nullptr if the property type is not supported */
+    const TCHAR* SqlType;
+
+    /** DatabaseIndex and DatabaseUnique property metadata */
+    bool bIndexed;
+    bool bUnique;
+
+    /**
+     * Get the number of bytes a value is persisted as, for the written byte counter.  Strings count their characters.
+     */
+    int32 GetValueSize(const void* ValuePtr) const;
+
+    /**
+     * Get a value as a query value it can be compared with.  Arrays and unsupported types are null.
+     */
+    FDataValue GetValue(const void* ValuePtr) const;
+
+    FORCEINLINE const void* GetValuePtr(const void* Container) const
+    {
+        return static_cast<const uint8*>(Container) + Offset;
+    }
+
+    FORCEINLINE void* GetValuePtr(void* Container) const
+    {
+        return static_cast<uint8*>(Container) + Offset;
+    }
+};
+
+/**
+ * An index declared through DatabaseIndex or DatabaseUnique metadata
+ */
+struct FSqliteIndex
+{
+    FString Name;
+    TArray<FString> Columns;
+    bool bUnique;
+};
+
+class FSqliteClassSchema;
+typedef TSharedRef<const FSqliteClassSchema, ESPMode::ThreadSafe> FSqliteClassSchemaRef;
+typedef TSharedPtr<const FSqliteClassSchema, ESPMode::ThreadSafe> FSqliteClassSchemaPtr;
+
+/**
+ * Immutable description of how a UClass is persisted.  Built once per class from reflection and
+ * metadata and shared by every operation so the per-row paths never walk properties or compare strings.
+ */
+class FSqliteClassSchema
+{
+public:
+    /**
+     * Get the schema for a class, building it on first use.  Schemas are forgotten once their class is garbage
+     * collected, so a class recreated by a hot reload gets a new one.
+     *
+     * @param   Class       class to get the schema for.  Must contain an int32 Id property
+     * @return              shared schema for the class
+     */
+    static FSqliteClassSchemaRef Get(UClass* Class);
+
+    /**
+     * Find a column by name
+     *
+     * @param   Name        column name to look for
+     * @return              index into Columns or INDEX_NONE
+     */
+    int32 FindColumn(const FString& Name) const;
+
+    /**
+     * Read the current row of a stepped select, built from SelectColumnList or BuildSelectColumnList, into a container
+     *
+     * @param   SqliteStatement     statement positioned on a row
+     * @param   Container           object or memory laid out like Class
+     * @param   ColumnMask          columns the select returns, one bit per entry of Columns.  0 for every column
+     * @return                      true if successful, false otherwise
+     */
+    bool ReadRow(sqlite3_stmt* const SqliteStatement, void* Container, uint64 ColumnMask = 0) const;
+
+    /**
+     * Build the column list of a select that only returns some columns
+     *
+     * @param   ColumnMask          bit per entry of Columns to select
+     * @return                      "Id,TestInt,..." in Columns order
+     */
+    FString BuildSelectColumnList(uint64 ColumnMask) const;
+
+    /**
+     * Build the SET list of an update that only writes some columns
+     *
+     * @param   ColumnMask          bit per entry of WritableColumns to set
+     * @param   bSetTimestamp       also set LastUpdateTimestamp, for statements using RETURNING
+     * @return                      "TestInt = ?,..." in WritableColumns order
+     */
+    FString BuildUpdateSetList(uint64 ColumnMask, bool bSetTimestamp) const;
+
+    /**
+     * Build the statement creating the table for this class, e.g. "CREATE TABLE IF NOT EXISTS TestObject (...);"
+     */
+    FString BuildCreateTableSql() const;
+
+    /**
+     * Build the statements creating the timestamp triggers and declared indexes.  Every statement uses IF NOT EXISTS
+     * so they can be run against an existing table.
+     *
+     * @param   OutStatements   statements to run after the table exists
+     */
+    void BuildSupportSql(TArray<FString>& OutStatements) const;
+
+    /** Class this schema describes */
+    UClass* Class;
+
+    /** Table name, same as the class name */
+    FString TableName;
+
+    /** Every SaveToDatabase property in reflection order.  This is the order of select result columns */
+    TArray<FSqliteColumn> Columns;
+
+    /**
+     * Indexes declared on the class.  Single column ones come from DatabaseIndex = "true" and DatabaseUnique = "true"
+     * property metadata, composite ones from DatabaseIndex = "A,B;C,D" and DatabaseUnique = "A,B" class metadata.
+     */
+    TArray<FSqliteIndex> Indexes;
+
+    /** Indices into Columns of properties that are bound on insert and update, in bind order */
+    TArray<int32> WritableColumns;
+
+    /** "Id,TestInt,..." for select statements */
+    FString SelectColumnList;
+
+    /** "(TestInt,...)" and "(?,...)" for insert statements */
+    FString InsertColumnList;
+    FString InsertValueList;
+
+    /** "TestInt = ?,..." for update statements */
+    FString UpdateSetList;
+
+    /** Insert and update lists that also set the timestamps, for statements using RETURNING */
+    FString InsertReturningColumnList;
+    FString InsertReturningValueList;
+    FString UpdateReturningSetList;
+
+    UIntProperty* IdProperty;
+    UIntProperty* CreateTimestampProperty;
+    UIntProperty* LastUpdateTimestampProperty;
+
+private:
+    explicit FSqliteClassSchema(UClass* Class);
+
+    /**
+     * Add the composite indexes listed in a class metadata value
+     */
+    void AddClassIndexes(const FString& Declaration, bool bUnique);
+
+    TMap<FString, int32> ColumnIndices;
+};
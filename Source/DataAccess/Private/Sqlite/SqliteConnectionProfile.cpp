@@ -0,0 +1,178 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteConnectionProfile.h"
+
+namespace SqliteConnectionProfileHelpers
+{
+    /**
+     * Run a pragma and read the first column of its first row, if any
+     */
+    bool RunPragma(sqlite3* Database, const FString& Pragma, FString& OutValue)
+    {
+        OutValue.Empty();
+
+        sqlite3_stmt* SqliteStatement = nullptr;
+        if(sqlite3_prepare_v2(Database, TCHAR_TO_UTF8(*Pragma), -1, &SqliteStatement, nullptr) != SQLITE_OK)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("RunPragma: cannot prepare \"%s\". Error message \"%s\""), *Pragma, UTF8_TO_TCHAR(sqlite3_errmsg(Database)));
+            sqlite3_finalize(SqliteStatement);
+            return false;
+        }
+
+        int32 ResultCode = sqlite3_step(SqliteStatement);
+        if(ResultCode == SQLITE_ROW)
+        {
+            OutValue = UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, 0));
+        }
+        else if(ResultCode != SQLITE_DONE)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("RunPragma: error executing \"%s\". Error message \"%s\""), *Pragma, UTF8_TO_TCHAR(sqlite3_errmsg(Database)));
+            sqlite3_finalize(SqliteStatement);
+            return false;
+        }
+
+        sqlite3_finalize(SqliteStatement);
+        return true;
+    }
+
+    FString NameFromIndex(const FString& Value, const TCHAR* const* Names, int32 NumNames)
+    {
+        int32 Index = FCString::Atoi(*Value);
+        return Value.IsNumeric() && Index >= 0 && Index < NumNames ? FString(Names[Index]) : Value;
+    }
+
+    TMap<FName, FSqliteConnectionProfile>& GetRegistry()
+    {
+        static TMap<FName, FSqliteConnectionProfile> Registry;
+        if(Registry.Num() == 0)
+        {
+            // Default rollback journal with every commit synced to disk
+            FSqliteConnectionProfile Durable;
+            Durable.JournalMode = "DELETE";
+            Durable.Synchronous = "FULL";
+            Registry.Add("Durable", Durable);
+
+            // WAL with NORMAL sync only risks the last commits on power loss, never corruption
+            FSqliteConnectionProfile FastSaveGame;
+            FastSaveGame.JournalMode = "WAL";
+            FastSaveGame.Synchronous = "NORMAL";
+            FastSaveGame.CacheSize = -16384;
+            FastSaveGame.MmapSize = 256 * 1024 * 1024;
+            FastSaveGame.TempStore = "MEMORY";
+            Registry.Add("FastSaveGame", FastSaveGame);
+
+            FSqliteConnectionProfile ReadMostly;
+            ReadMostly.JournalMode = "WAL";
+            ReadMostly.Synchronous = "NORMAL";
+            ReadMostly.CacheSize = -65536;
+            ReadMostly.MmapSize = 1024 * 1024 * 1024;
+            ReadMostly.TempStore = "MEMORY";
+            Registry.Add("ReadMostly", ReadMostly);
+        }
+        return Registry;
+    }
+
+    FCriticalSection RegistryLock;
+}
+
+bool FSqliteConnectionProfile::Apply(sqlite3* Database) const
+{
+    check(Database);
+
+    using namespace SqliteConnectionProfileHelpers;
+    FString Result;
+    bool bSuccess = true;
+
+    // page_size cannot change once the database is in WAL mode, so it goes first
+    if(PageSize > 0)
+    {
+        bSuccess &= RunPragma(Database, FString::Printf(TEXT("PRAGMA page_size=%i;"), PageSize), Result);
+    }
+
+    if(!JournalMode.IsEmpty())
+    {
+        bSuccess &= RunPragma(Database, FString::Printf(TEXT("PRAGMA journal_mode=%s;"), *JournalMode), Result);
+        if(!Result.Equals(JournalMode, ESearchCase::IgnoreCase))
+        {
+            UE_LOG(LogDataAccess, Warning, TEXT("Apply: journal_mode %s requested, sqlite kept %s"), *JournalMode, *Result);
+        }
+    }
+
+    if(!Synchronous.IsEmpty())
+    {
+        bSuccess &= RunPragma(Database, FString::Printf(TEXT("PRAGMA synchronous=%s;"), *Synchronous), Result);
+    }
+
+    if(CacheSize != 0)
+    {
+        bSuccess &= RunPragma(Database, FString::Printf(TEXT("PRAGMA cache_size=%i;"), CacheSize), Result);
+    }
+
+    if(MmapSize >= 0)
+    {
+        bSuccess &= RunPragma(Database, FString::Printf(TEXT("PRAGMA mmap_size=%lld;"), MmapSize), Result);
+    }
+
+    if(!TempStore.IsEmpty())
+    {
+        bSuccess &= RunPragma(Database, FString::Printf(TEXT("PRAGMA temp_store=%s;"), *TempStore), Result);
+    }
+
+    return bSuccess;
+}
+
+void FSqliteConnectionProfile::Register(FName Name, const FSqliteConnectionProfile& Profile)
+{
+    FScopeLock ScopeLock(&SqliteConnectionProfileHelpers::RegistryLock);
+    SqliteConnectionProfileHelpers::GetRegistry().Add(Name, Profile);
+}
+
+bool FSqliteConnectionProfile::Find(FName Name, FSqliteConnectionProfile& OutProfile)
+{
+    FScopeLock ScopeLock(&SqliteConnectionProfileHelpers::RegistryLock);
+    const FSqliteConnectionProfile* Found = SqliteConnectionProfileHelpers::GetRegistry().Find(Name);
+    if(!Found)
+    {
+        return false;
+    }
+
+    OutProfile = *Found;
+    return true;
+}
+
+bool FSqliteConnectionSettings::Read(sqlite3* Database)
+{
+    check(Database);
+
+    using namespace SqliteConnectionProfileHelpers;
+    static const TCHAR* const SynchronousNames[] = { TEXT("OFF"), TEXT("NORMAL"), TEXT("FULL"), TEXT("EXTRA") };
+    static const TCHAR* const TempStoreNames[] = { TEXT("DEFAULT"), TEXT("FILE"), TEXT("MEMORY") };
+
+    FString Result;
+    bool bSuccess = true;
+
+    bSuccess &= RunPragma(Database, "PRAGMA journal_mode;", JournalMode);
+
+    bSuccess &= RunPragma(Database, "PRAGMA synchronous;", Result);
+    Synchronous = NameFromIndex(Result, SynchronousNames, ARRAY_COUNT(SynchronousNames));
+
+    bSuccess &= RunPragma(Database, "PRAGMA cache_size;", Result);
+    CacheSize = FCString::Atoi(*Result);
+
+    // Builds without mmap support return no row
+    bSuccess &= RunPragma(Database, "PRAGMA mmap_size;", Result);
+    MmapSize = FCString::Atoi64(*Result);
+
+    bSuccess &= RunPragma(Database, "PRAGMA temp_store;", Result);
+    TempStore = NameFromIndex(Result, TempStoreNames, ARRAY_COUNT(TempStoreNames));
+
+    bSuccess &= RunPragma(Database, "PRAGMA page_size;", Result);
+    PageSize = FCString::Atoi(*Result);
+
+    return bSuccess;
+}
+
+FString FSqliteConnectionSettings::ToString() const
+{
+    return FString::Printf(TEXT("journal_mode=%s synchronous=%s cache_size=%i mmap_size=%lld temp_store=%s page_size=%i"), *JournalMode, *Synchronous, CacheSize, MmapSize, *TempStore, PageSize);
+}
@@ -0,0 +1,85 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteDataResource.h"
+#include "SqliteDataCursor.h"
+#include "DataAccessStats.h"
+
+SqliteDataCursor::SqliteDataCursor(TSharedPtr<SqliteDataResource> DataResource, FSqliteClassSchemaRef Schema, sqlite3_stmt* SqliteStatement, uint64 ColumnMask)
+: DataResource(DataResource)
+, Schema(Schema)
+, SqliteStatement(SqliteStatement)
+, ColumnMask(ColumnMask)
+, bOnRow(false)
+, bError(false)
+{
+    check(SqliteStatement);
+}
+
+SqliteDataCursor::~SqliteDataCursor()
+{
+    ReleaseStatement();
+}
+
+bool SqliteDataCursor::Next()
+{
+    bOnRow = false;
+    if(!SqliteStatement)
+    {
+        return false;
+    }
+    
+    int32 ResultCode = SqliteStepTimed(SqliteStatement);
+    if(ResultCode == SQLITE_ROW)
+    {
+        bOnRow = true;
+        return true;
+    }
+    
+    if(ResultCode != SQLITE_DONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Next: error stepping cursor. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(sqlite3_db_handle(SqliteStatement))));
+        bError = true;
+    }
+    
+    // Hand the statement back as soon as the results are exhausted
+    ReleaseStatement();
+    return false;
+}
+
+bool SqliteDataCursor::Read(UObject* const OutObj)
+{
+    check(OutObj);
+    check(OutObj->GetClass() == Schema->Class);
+    
+    if(!bOnRow)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Read: cursor is not positioned on a row"));
+        return false;
+    }
+    
+    if(!Schema->ReadRow(SqliteStatement, OutObj, ColumnMask))
+    {
+        return false;
+    }
+    
+    // A partially read object does not hold its persisted values
+    if(ColumnMask == 0 && DataResource->UsesSnapshots())
+    {
+        DataResource->GetSnapshots().Store(*Schema, OutObj);
+    }
+    return true;
+}
+
+bool SqliteDataCursor::HasError() const
+{
+    return bError;
+}
+
+void SqliteDataCursor::ReleaseStatement()
+{
+    if(SqliteStatement)
+    {
+        DataResource->ReturnStatement(SqliteStatement);
+        SqliteStatement = nullptr;
+    }
+}
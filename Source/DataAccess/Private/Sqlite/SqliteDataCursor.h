@@ -0,0 +1,41 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+#include "IDataCursor.h"
+#include "SqliteClassSchema.h"
+
+class SqliteDataResource;
+
+/**
+ * Implementation of IDataCursor for Sqlite.  Holds a checked out statement from the connection's statement cache
+ * until the results are exhausted or the cursor is destroyed.  A cursor can outlive the resource's Release, its
+ * connection stays open until the statement is returned.
+ */
+class SqliteDataCursor : public IDataCursor
+{
+public:
+    /**
+     * @param   DataResource        resource the statement was prepared on
+     * @param   Schema              schema of the selected class
+     * @param   SqliteStatement     bound select statement, ownership is taken by the cursor
+     * @param   ColumnMask          columns the statement selects, one bit per entry of the schema's Columns.  0 for every column
+     */
+    SqliteDataCursor(TSharedPtr<SqliteDataResource> DataResource, FSqliteClassSchemaRef Schema, sqlite3_stmt* SqliteStatement, uint64 ColumnMask = 0);
+    virtual ~SqliteDataCursor();
+    
+    // IDataCursor interface
+    virtual bool Next();
+    virtual bool Read(UObject* const OutObj);
+    virtual bool HasError() const;
+    // End of IDataCursor interface
+    
+private:
+    void ReleaseStatement();
+    
+    TSharedPtr<SqliteDataResource> DataResource;
+    FSqliteClassSchemaRef Schema;
+    sqlite3_stmt* SqliteStatement;
+    uint64 ColumnMask;
+    bool bOnRow;
+    bool bError;
+};
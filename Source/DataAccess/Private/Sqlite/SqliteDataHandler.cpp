@@ -2,12 +2,69 @@
 #include "DataAccessPrivatePCH.h"
 #include "SqliteDataResource.h"
 #include "SqliteDataHandler.h"
+#include "SqliteClassSchema.h"
+#include "SqliteDataCursor.h"
+#include "DataObjectPool.h"
+#include "DataAccessStats.h"
+#include "SqliteScratchArena.h"
+
+namespace SqliteDataHandlerHelpers
+{
+    /** Source of the handlers' savepoint prefixes */
+    FThreadSafeCounter NextSavepointPrefix;
+    
+    /**
+     * Read a result column as a query value of its storage class
+     */
+    FDataValue ReadColumnValue(sqlite3_stmt* const SqliteStatement, int32 ColumnIndex)
+    {
+        switch(sqlite3_column_type(SqliteStatement, ColumnIndex))
+        {
+        case SQLITE_INTEGER:
+            return FDataValue(static_cast<int64>(sqlite3_column_int64(SqliteStatement, ColumnIndex)));
+        case SQLITE_FLOAT:
+            return FDataValue(sqlite3_column_double(SqliteStatement, ColumnIndex));
+        case SQLITE_TEXT:
+            return FDataValue(FString(UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, ColumnIndex))));
+        default:
+            return FDataValue();
+        }
+    }
+    
+    /**
+     * Add a column to a projection mask
+     *
+     * @param   Mask            mask with one bit per column of the schema
+     * @param   ColumnIndex     index of the column in the schema
+     * @param   FieldName       name of the column, for the error
+     * @param   Class           class the schema belongs to, for the error
+     * @return                  true if the column was added, false if it does not fit in the mask
+     */
+    bool AddSelectColumn(uint64& Mask, int32 ColumnIndex, const FString& FieldName, UClass* Class)
+    {
+        if(ColumnIndex >= 64)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("Select: FieldName \"%s\" is past the 64th column of UClass \"%s\" and cannot be selected.  The query will fail"), *(FieldName), *(Class->GetName()));
+            return false;
+        }
+        
+        Mask |= 1ull << ColumnIndex;
+        return true;
+    }
+}
 
 SqliteDataHandler::SqliteDataHandler(TSharedPtr<SqliteDataResource> DataResource)
 : DataResource(DataResource)
 , QueryStarted(false)
 , SourceClass(nullptr)
-
+, SelectMask(0)
+, bSelectFailed(false)
+, QueryLimit(INDEX_NONE)
+, QueryOffset(0)
+, TransactionDepth(0)
+, bOwnsTransaction(false)
+, SavepointPrefix(SqliteDataHandlerHelpers::NextSavepointPrefix.Increment())
+, Scratch(new FSqliteScratchArena())
 {
     QueryParts.Empty();
     QueryParameters.Empty();
@@ -15,6 +72,15 @@ SqliteDataHandler::SqliteDataHandler(TSharedPtr<SqliteDataResource> DataResource
 
 SqliteDataHandler::~SqliteDataHandler()
 {
+    if(TransactionDepth > 0)
+    {
+        UE_LOG(LogDataAccess, Warning, TEXT("~SqliteDataHandler: %i open transaction levels rolled back"), TransactionDepth);
+        while(TransactionDepth > 0)
+        {
+            Rollback();
+        }
+    }
+    
     QueryParts.Empty();
     QueryParameters.Empty();
     DataResource.Reset();
@@ -23,13 +89,23 @@ SqliteDataHandler::~SqliteDataHandler()
 IDataHandler& SqliteDataHandler::Source(UClass* Source)
 {
     check(Source);
-    UIntProperty* IdProperty = FindFieldChecked<UIntProperty>(Source, "Id");
-    check(IdProperty);
     
     QueryStarted = true;
     SourceClass = Source;
-    QueryParts.Empty();
-    QueryParameters.Empty();
+    SourceSchema = FSqliteClassSchema::Get(Source);
+    QueryParts.Reset();
+    QueryParameters.Reset();
+    SelectMask = 0;
+    bSelectFailed = false;
+    OrderParts.Reset();
+    GroupParts.Reset();
+    SetParts.Reset();
+    SetParameters.Reset();
+    QueryLimit = INDEX_NONE;
+    QueryOffset = 0;
+    KeysetParts.Reset();
+    KeysetValues.Reset();
+    CompiledShape.Reset();
     
     return *this;
 }
@@ -37,23 +113,44 @@ IDataHandler& SqliteDataHandler::Source(UClass* Source)
 IDataHandler& SqliteDataHandler::Where(FString FieldName, EDataHandlerOperator Operator, FString Condition)
 {
     check(QueryStarted == true);
-    bool bFound = false;
     
-    UClass* FieldType = nullptr;
-    // Terrible search, could be implemented better
-    for(TFieldIterator<UProperty> Itr(SourceClass); Itr; ++Itr)
+    int32 ColumnIndex = SourceSchema->FindColumn(FieldName);
+    if(ColumnIndex == INDEX_NONE)
     {
-        UProperty* Property = *Itr;
-        
-        if(Property->GetName() == FieldName)
-        {
-            bFound = true;
-            FieldType = Property->GetClass();
-            break;
-        }
+        UE_LOG(LogDataAccess, Error, TEXT("Where: FieldName \"%s\" does not exist in UClass \"%s\".  Clause not added"), *(FieldName), *(SourceClass->GetName()));
+        return *this;
+    }
+    
+    // Parse the condition once here instead of every time the statement is bound
+    const TCHAR* SqlType = SourceSchema->Columns[ColumnIndex].SqlType;
+    EDataValueType::Type ValueType = EDataValueType::Null;
+    if(SqlType == nullptr || FCString::Strcmp(SqlType, TEXT("BLOB")) == 0)
+    {
+        // Binds null, which matches nothing, instead of dropping the clause and widening the query
+        UE_LOG(LogDataAccess, Error, TEXT("Where: Data type of \"%s\" is not supported"), *(FieldName));
     }
+    else if(FCString::Strcmp(SqlType, TEXT("REAL")) == 0)
+    {
+        ValueType = EDataValueType::Real;
+    }
+    else if(FCString::Strcmp(SqlType, TEXT("TEXT")) == 0)
+    {
+        ValueType = EDataValueType::Text;
+    }
+    else
+    {
+        ValueType = EDataValueType::Integer;
+    }
+    
+    return Where(FieldName, Operator, FDataValue::FromString(Condition, ValueType));
+}
+
+IDataHandler& SqliteDataHandler::Where(FString FieldName, EDataHandlerOperator Operator, const FDataValue& Value)
+{
+    check(QueryStarted == true);
+    check(!CompiledShape.IsValid());
     
-    if(!bFound)
+    if(SourceSchema->FindColumn(FieldName) == INDEX_NONE)
     {
         UE_LOG(LogDataAccess, Error, TEXT("Where: FieldName \"%s\" does not exist in UClass \"%s\".  Clause not added"), *(FieldName), *(SourceClass->GetName()));
         return *this;
@@ -84,19 +181,166 @@ IDataHandler& SqliteDataHandler::Where(FString FieldName, EDataHandlerOperator O
     }
     
     QueryParts.Add("?");
-   
-    TPair<UClass*, FString> NewPair;
-    NewPair.Key = FieldType;
-    NewPair.Value = Condition;
+    QueryParameters.Add(Value);
+    
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::Select(const TArray<FName>& Fields)
+{
+    check(QueryStarted == true);
+    
+    // The Id is always read so a partially read object can still be updated or looked up again
+    uint64 Mask = 0;
+    const int32 IdColumn = SourceSchema->FindColumn("Id");
+    if(IdColumn != INDEX_NONE && !SqliteDataHandlerHelpers::AddSelectColumn(Mask, IdColumn, "Id", SourceClass))
+    {
+        bSelectFailed = true;
+        return *this;
+    }
+    
+    for(const FName& Field : Fields)
+    {
+        FString FieldName = Field.ToString();
+        int32 ColumnIndex = SourceSchema->FindColumn(FieldName);
+        if(ColumnIndex == INDEX_NONE)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("Select: FieldName \"%s\" does not exist in UClass \"%s\".  Field not selected"), *(FieldName), *(SourceClass->GetName()));
+            continue;
+        }
+        
+        if(!SqliteDataHandlerHelpers::AddSelectColumn(Mask, ColumnIndex, FieldName, SourceClass))
+        {
+            bSelectFailed = true;
+            return *this;
+        }
+    }
+    
+    // Ordered fields are read as well so the last row of a page can be passed to After
+    const TArray<FString>& Order = GetOrderParts();
+    for(int32 i = 0; i < Order.Num(); i += 2)
+    {
+        if(!SqliteDataHandlerHelpers::AddSelectColumn(Mask, SourceSchema->FindColumn(Order[i]), Order[i], SourceClass))
+        {
+            bSelectFailed = true;
+            return *this;
+        }
+    }
+    
+    // Selecting everything shares the statement that selects every column
+    const int32 NumColumns = SourceSchema->Columns.Num();
+    const uint64 AllColumns = NumColumns >= 64 ? MAX_uint64 : (1ull << NumColumns) - 1;
+    SelectMask = Mask == AllColumns ? 0 : Mask;
+    
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::OrderBy(FString FieldName, EDataSortOrder Order)
+{
+    check(QueryStarted == true);
+    check(!CompiledShape.IsValid());
+    check(KeysetValues.Num() == 0);
+    
+    int32 ColumnIndex = SourceSchema->FindColumn(FieldName);
+    if(ColumnIndex == INDEX_NONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("OrderBy: FieldName \"%s\" does not exist in UClass \"%s\".  Order not added"), *(FieldName), *(SourceClass->GetName()));
+        return *this;
+    }
+    
+    OrderParts.Add(FieldName);
+    OrderParts.Add(Order == EDataSortOrder::Descending ? "DESC" : "ASC");
+    
+    // A projection has to read the field for After
+    if(SelectMask != 0 && !SqliteDataHandlerHelpers::AddSelectColumn(SelectMask, ColumnIndex, FieldName, SourceClass))
+    {
+        bSelectFailed = true;
+    }
+    
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::Limit(int32 Count)
+{
+    check(QueryStarted == true);
+    QueryLimit = Count < 0 ? INDEX_NONE : Count;
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::Offset(int32 Count)
+{
+    check(QueryStarted == true);
+    QueryOffset = FMath::Max(Count, 0);
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::After(const UObject* const Row)
+{
+    check(QueryStarted == true);
+    check(Row);
+    check(Row->GetClass() == SourceClass);
+    
+    // Compare in the same total order every page is sorted in, by Id alone if there is no OrderBy
+    GetTotalOrderParts(KeysetParts);
+    if(KeysetParts.Num() == 0)
+    {
+        KeysetParts.Add("Id");
+        KeysetParts.Add("ASC");
+    }
+    
+    KeysetValues.Reset();
+    for(int32 i = 0; i < KeysetParts.Num(); i += 2)
+    {
+        const FSqliteColumn& Column = SourceSchema->Columns[SourceSchema->FindColumn(KeysetParts[i])];
+        KeysetValues.Add(Column.GetValue(Column.GetValuePtr(Row)));
+    }
+    
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::GroupBy(FString FieldName)
+{
+    check(QueryStarted == true);
+    check(!CompiledShape.IsValid());
+    
+    if(SourceSchema->FindColumn(FieldName) == INDEX_NONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("GroupBy: FieldName \"%s\" does not exist in UClass \"%s\".  Group not added"), *(FieldName), *(SourceClass->GetName()));
+        return *this;
+    }
+    
+    GroupParts.Add(FieldName);
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::Set(FString FieldName, const FDataValue& Value)
+{
+    check(QueryStarted == true);
+    AddSetPart(FieldName, FString::Printf(TEXT("%s = ?"), *FieldName), Value);
+    return *this;
+}
+
+IDataHandler& SqliteDataHandler::Increment(FString FieldName, const FDataValue& Amount)
+{
+    check(QueryStarted == true);
     
-    QueryParameters.Add(NewPair);
+    int32 ColumnIndex = SourceSchema->FindColumn(FieldName);
+    const TCHAR* SqlType = ColumnIndex != INDEX_NONE ? SourceSchema->Columns[ColumnIndex].SqlType : nullptr;
+    if((Amount.GetType() != EDataValueType::Integer && Amount.GetType() != EDataValueType::Real) ||
+       (SqlType && (FCString::Strcmp(SqlType, TEXT("TEXT")) == 0 || FCString::Strcmp(SqlType, TEXT("BLOB")) == 0)))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Increment: FieldName \"%s\" or its amount is not numeric.  Assignment not added"), *(FieldName));
+        return *this;
+    }
     
+    AddSetPart(FieldName, FString::Printf(TEXT("%s = %s + ?"), *FieldName, *FieldName), Amount);
     return *this;
 }
 
 IDataHandler& SqliteDataHandler::Or()
 {
     check(QueryStarted == true);
+    check(!CompiledShape.IsValid());
     QueryParts.Add("OR");
     return *this;
 }
@@ -104,6 +348,7 @@ IDataHandler& SqliteDataHandler::Or()
 IDataHandler& SqliteDataHandler::And()
 {
     check(QueryStarted == true);
+    check(!CompiledShape.IsValid());
     QueryParts.Add("AND");
     return *this;
 }
@@ -111,6 +356,7 @@ IDataHandler& SqliteDataHandler::And()
 IDataHandler& SqliteDataHandler::BeginNested()
 {
     check(QueryStarted == true);
+    check(!CompiledShape.IsValid());
     QueryParts.Add("(");
     return *this;
 }
@@ -118,274 +364,420 @@ IDataHandler& SqliteDataHandler::BeginNested()
 IDataHandler& SqliteDataHandler::EndNested()
 {
     check(QueryStarted == true);
+    check(!CompiledShape.IsValid());
     QueryParts.Add(")");
     return *this;
 }
 
-bool SqliteDataHandler::Create(UObject* const Obj)
+FCompiledDataQuery SqliteDataHandler::Compile()
 {
-    check(Obj);
     check(QueryStarted == true);
-    // Check that our object exists and that it had an Id property
-    check(Obj->GetClass()->GetName() == SourceClass->GetName());
+    check(KeysetValues.Num() == 0);
     
-    // Build column names and values for the insert
-    FString Columns("(");
-    FString Values("(");
+    TSharedRef<FCompiledDataQuery::FShape, ESPMode::ThreadSafe> Shape = MakeShareable(new FCompiledDataQuery::FShape());
+    Shape->Source = SourceClass;
+    Shape->Parts = GetQueryParts();
+    Shape->WhereClause = GenerateWhereClause();
+    Shape->SelectMask = SelectMask;
+    Shape->bSelectFailed = bSelectFailed;
+    Shape->OrderParts = GetOrderParts();
+    Shape->GroupParts = GetGroupParts();
+    Shape->SetParts = SetParts;
+    Shape->SetValues = SetParameters;
+    Shape->Limit = QueryLimit;
+    Shape->Offset = QueryOffset;
     
-    for(TFieldIterator<UProperty> Itr(Obj->GetClass()); Itr; ++Itr)
-    {
-        UProperty* Property = *Itr;
-        
-		if (Property->GetName() == "Id" || Property->GetName() == "CreateTimestamp" || Property->GetName() == "LastUpdateTimestamp" || !Property->HasMetaData("SaveToDatabase") || !Property->GetMetaData("SaveToDatabase").ToUpper().Equals("TRUE"))
-        {
-            continue;
-        }
-		
-        Columns += FString::Printf(TEXT("%s,"), *(Property->GetName()));
-        Values += "?,";
-    }
-    Columns.RemoveFromEnd(",", ESearchCase::IgnoreCase);
-    Values.RemoveFromEnd(",", ESearchCase::IgnoreCase);
-    Columns += ")";
-    Values += ")";
+    FCompiledDataQuery Compiled(Shape, QueryParameters);
+    ClearQuery();
+    return Compiled;
+}
+
+IDataHandler& SqliteDataHandler::Query(const FCompiledDataQuery& Compiled)
+{
+    check(Compiled.IsValid());
     
-    FString SqlStatement(FString::Printf(TEXT("INSERT INTO %s %s VALUES %s;"), *(Obj->GetClass()->GetName()), *Columns, *Values));
+    Source(Compiled.GetSource());
+    CompiledShape = Compiled.GetShape();
+    QueryParameters = Compiled.GetParameters();
+    SelectMask = CompiledShape->SelectMask;
+    bSelectFailed = CompiledShape->bSelectFailed;
+    SetParts = CompiledShape->SetParts;
+    SetParameters = CompiledShape->SetValues;
+    QueryLimit = CompiledShape->Limit;
+    QueryOffset = CompiledShape->Offset;
+    
+    return *this;
+}
+
+bool SqliteDataHandler::Create(UObject* const Obj)
+{
+    DATAACCESS_SCOPE_OPERATION(Create);
+    check(Obj);
+    check(QueryStarted == true);
+    // Check that our object exists and that it had an Id property
+    check(Obj->GetClass() == SourceClass);
     
     // Create a prepared statement and bind the UObject to it
-    sqlite3_stmt* SqliteStatement;
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*SqlStatement), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    sqlite3_stmt* InsertStatement;
+    sqlite3_stmt* TimestampStatement;
+    if(!AcquireWriteStatements(ESqliteStatementType::Insert, FString(), InsertStatement, TimestampStatement))
     {
         UE_LOG(LogDataAccess, Error, TEXT("Create: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
         ClearQuery();
         return false;
     }
     
-    if(!BindObjectToStatement(Obj, SqliteStatement))
+    bool bSuccess = InsertObject(Obj, InsertStatement, TimestampStatement);
+    if(bSuccess)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: error binding sqlite statement."));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
+        StoreSnapshot(Obj);
     }
     
-    // Execute
-    if(sqlite3_step(SqliteStatement) != SQLITE_DONE)
+    ReleaseStatement(InsertStatement);
+    ReleaseStatement(TimestampStatement);
+    ClearQuery();
+    return bSuccess;
+}
+
+bool SqliteDataHandler::CreateMany(const TArray<UObject*>& Objs)
+{
+    DATAACCESS_SCOPE_OPERATION(CreateMany);
+    check(QueryStarted == true);
+    
+    if(Objs.Num() == 0)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: error executing insert statement.. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
         ClearQuery();
-        return false;
+        return true;
     }
-    sqlite3_finalize(SqliteStatement);
     
-
-    // Get last id, create, and update timestamps and update the UObject
-    int32 LastId = sqlite3_last_insert_rowid(DataResource->Get());
-    UIntProperty* IdProperty = FindFieldChecked<UIntProperty>(Obj->GetClass(), "Id");
-    IdProperty->SetPropertyValue_InContainer(Obj, LastId);
-    
-    SqlStatement = FString::Printf(TEXT("SELECT CreateTimestamp, LastUpdateTimestamp FROM %s WHERE Id = ?;"), *(Obj->GetClass()->GetName()));
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*(SqlStatement)), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    // One transaction for the whole batch so the journal is only synced once.  Nests as a savepoint in an open transaction.
+    if(!BeginTransaction(EDataTransactionMode::Immediate))
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot prepare sqlite statement for timestamps. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("CreateMany: cannot begin transaction."));
         ClearQuery();
         return false;
     }
     
-    if(sqlite3_bind_int(SqliteStatement, 1, LastId))
+    sqlite3_stmt* InsertStatement;
+    sqlite3_stmt* TimestampStatement;
+    bool bSuccess = AcquireWriteStatements(ESqliteStatementType::Insert, FString(), InsertStatement, TimestampStatement);
+    if(!bSuccess)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot bind class name to sqlite statement for seq. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
+        UE_LOG(LogDataAccess, Error, TEXT("CreateMany: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
     }
     
-    if(sqlite3_step(SqliteStatement) != SQLITE_ROW)
+    for(int32 i = 0; bSuccess && i < Objs.Num(); ++i)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot step sqlite statement for seq. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
+        check(Objs[i]);
+        check(Objs[i]->GetClass() == SourceClass);
+        bSuccess = InsertObject(Objs[i], InsertStatement, TimestampStatement);
+        if(bSuccess)
+        {
+            StoreSnapshot(Objs[i]);
+        }
     }
-   
-    UIntProperty* CreateTimestampProperty = FindFieldChecked<UIntProperty>(Obj->GetClass(), "CreateTimestamp");
-    CreateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, 0));
-
-    UIntProperty* LastUpdateTimestampProperty = FindFieldChecked<UIntProperty>(Obj->GetClass(), "LastUpdateTimestamp");
-    LastUpdateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, 1));
-
-    sqlite3_finalize(SqliteStatement);
+    
+    ReleaseStatement(InsertStatement);
+    ReleaseStatement(TimestampStatement);
+    
+    bSuccess = bSuccess && Commit();
+    if(!bSuccess)
+    {
+        Rollback();
+    }
+    
     ClearQuery();
-    return true;
+    return bSuccess;
 }
 
-
 bool SqliteDataHandler::Update(UObject* const Obj)
 {
+    DATAACCESS_SCOPE_OPERATION(Update);
     check(Obj);
     check(QueryStarted == true);
-    check(Obj->GetClass()->GetName() == SourceClass->GetName());
+    check(Obj->GetClass() == SourceClass);
     
-    // Build set commands for the update
-    FString Sets;
-    int32 PropertyCount = 0;
-    for(TFieldIterator<UProperty> Itr(Obj->GetClass()); Itr; ++Itr)
+    FString WhereClause = GenerateWhereClause();
+    
+    // Only an update of this object's own record can be diffed against its snapshot
+    int32 WhereId;
+    bool bUpdateById = GetWhereId(WhereId) && WhereId == SourceSchema->IdProperty->GetPropertyValue_InContainer(Obj);
+    uint64 ColumnMask = 0;
+    if(bUpdateById && !GetChangedColumns(Obj, ColumnMask))
     {
-        UProperty* Property = *Itr;
-		if (Property->GetName() == "Id" || Property->GetName() == "CreateTimestamp" || Property->GetName() == "LastUpdateTimestamp" || !Property->HasMetaData("SaveToDatabase") || !Property->GetMetaData("SaveToDatabase").ToUpper().Equals("TRUE"))
-        {
-            continue;
-        }
-
-        ++PropertyCount;
-        Sets += FString::Printf(TEXT("%s = ?,"), *(Property->GetName()));
+        ClearQuery();
+        return true;
     }
-    Sets.RemoveFromEnd(",", ESearchCase::IgnoreCase);
-    
-    FString SqlStatement(FString::Printf(TEXT("UPDATE %s SET %s %s;"), *(SourceClass->GetName()), *Sets, *(GenerateWhereClause())));
     
     // Prepare a statement and bind the UObject to it.  Also bind the update Id.
-    sqlite3_stmt* SqliteStatement;
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*SqlStatement), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    sqlite3_stmt* UpdateStatement;
+    sqlite3_stmt* TimestampStatement;
+    if(!AcquireWriteStatements(ESqliteStatementType::Update, WhereClause, UpdateStatement, TimestampStatement, ColumnMask))
     {
         UE_LOG(LogDataAccess, Error, TEXT("Update: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
         ClearQuery();
         return false;
     }
     
-    if(!BindObjectToStatement(Obj, SqliteStatement))
+    int32 UpdatedRows = 0;
+    bool bSuccess = UpdateObject(Obj, UpdateStatement, TimestampStatement, true, UpdatedRows, ColumnMask) && UpdatedRows > 0;
+    if(bSuccess && bUpdateById)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Update: error binding sqlite statement."));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
+        StoreSnapshot(Obj);
     }
-
-    // Bind Where Paramters
-    if(!BindWhereToStatement(SqliteStatement, PropertyCount + 1))
+    else if(bSuccess && DataResource->UsesSnapshots())
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Update: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
+        // Every matched record now holds this object's values and which records those were is unknown
+        DataResource->GetSnapshots().RemoveClass(SourceClass);
     }
+    
+    ReleaseStatement(UpdateStatement);
+    ReleaseStatement(TimestampStatement);
+    ClearQuery();
+    return bSuccess;
+}
 
-    // Execute
-    if(sqlite3_step(SqliteStatement) != SQLITE_DONE)
-    {
-        UE_LOG(LogDataAccess, Error, TEXT("Update: error executing update statement.. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
-    }
+bool SqliteDataHandler::UpdateMany(const TArray<UObject*>& Objs)
+{
+    DATAACCESS_SCOPE_OPERATION(UpdateMany);
+    return UpdateObjects(Objs, nullptr);
+}
+
+bool SqliteDataHandler::UpdateMany(const TArray<UObject*>& Objs, TArray<UObject*>& OutMissing)
+{
+    DATAACCESS_SCOPE_OPERATION(UpdateMany);
+    OutMissing.Reset();
+    return UpdateObjects(Objs, &OutMissing);
+}
+
+bool SqliteDataHandler::UpdateObjects(const TArray<UObject*>& Objs, TArray<UObject*>* OutMissing)
+{
+    check(QueryStarted == true);
     
-    if(sqlite3_changes(DataResource->Get()) == 0)
+    if(GetQueryParts().Num() > 0)
     {
-        UE_LOG(LogDataAccess, Log, TEXT("Update: Nothing to update"));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
+        UE_LOG(LogDataAccess, Warning, TEXT("UpdateMany: where clause is ignored, objects are matched by Id"));
     }
-    sqlite3_finalize(SqliteStatement);
     
-    // Get create and update timestamps and update the UObject
-    SqlStatement = FString::Printf(TEXT("SELECT DISTINCT LastUpdateTimestamp FROM %s %s;"), *(Obj->GetClass()->GetName()), *(GenerateWhereClause()));
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*(SqlStatement)), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    if(Objs.Num() == 0)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot prepare sqlite statement for timestamp. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
         ClearQuery();
-        return false;
+        return true;
     }
     
-    if(!BindWhereToStatement(SqliteStatement, 1))
+    if(!BeginTransaction(EDataTransactionMode::Immediate))
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot bind where clause for timestamp. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("UpdateMany: cannot begin transaction."));
         ClearQuery();
         return false;
     }
     
-    if(sqlite3_step(SqliteStatement) != SQLITE_ROW)
+    const FString WhereClause(TEXT("WHERE Id = ?"));
+    sqlite3_stmt* UpdateStatement;
+    sqlite3_stmt* TimestampStatement;
+    bool bSuccess = AcquireWriteStatements(ESqliteStatementType::Update, WhereClause, UpdateStatement, TimestampStatement);
+    if(!bSuccess)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot step sqlite statement for seq. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
-        ClearQuery();
-        return false;
+        UE_LOG(LogDataAccess, Error, TEXT("UpdateMany: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
     }
-   
-    UIntProperty* LastUpdateTimestampProperty = FindFieldChecked<UIntProperty>(Obj->GetClass(), "LastUpdateTimestamp");
-    LastUpdateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, 0));
-    
-    sqlite3_finalize(SqliteStatement);
-    ClearQuery();
-    return true;
-}
-
-bool SqliteDataHandler::Delete()
-{
-    check(QueryStarted == true);
     
-    FString SqlStatement(FString::Printf(TEXT("DELETE FROM %s %s"), *(SourceClass->GetName()), *(GenerateWhereClause())));
-    
-    // Prepare a statement and bind the Id to it
-    sqlite3_stmt* SqliteStatement;
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*SqlStatement), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    for(int32 i = 0; bSuccess && i < Objs.Num(); ++i)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Delete: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        check(Objs[i]);
+        check(Objs[i]->GetClass() == SourceClass);
+        
+        uint64 ColumnMask = 0;
+        if(!GetChangedColumns(Objs[i], ColumnMask))
+        {
+            continue;
+        }
+        
+        int32 UpdatedRows = 0;
+        if(ColumnMask == 0)
+        {
+            bSuccess = UpdateObject(Objs[i], UpdateStatement, TimestampStatement, false, UpdatedRows);
+        }
+        else
+        {
+            // Objects changing only some columns get a statement for just those columns, the timestamp select is shared
+            sqlite3_stmt* PartialUpdateStatement = AcquireStatement(TimestampStatement ? ESqliteStatementType::Update : ESqliteStatementType::UpdateReturning, WhereClause, ColumnMask);
+            if(!PartialUpdateStatement)
+            {
+                UE_LOG(LogDataAccess, Error, TEXT("UpdateMany: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+                bSuccess = false;
+                break;
+            }
+            
+            bSuccess = UpdateObject(Objs[i], PartialUpdateStatement, TimestampStatement, false, UpdatedRows, ColumnMask);
+            ReleaseStatement(PartialUpdateStatement);
+        }
+        
+        // A record deleted since the object was read is only an error if the caller did not ask for the missing ones
+        if(bSuccess && UpdatedRows == 0)
+        {
+            if(OutMissing)
+            {
+                OutMissing->Add(Objs[i]);
+            }
+            else
+            {
+                bSuccess = false;
+            }
+        }
+        else if(bSuccess)
+        {
+            StoreSnapshot(Objs[i]);
+        }
+    }
+    
+    ReleaseStatement(UpdateStatement);
+    ReleaseStatement(TimestampStatement);
+    
+    bSuccess = bSuccess && Commit();
+    if(!bSuccess)
+    {
+        Rollback();
+    }
+    
+    ClearQuery();
+    return bSuccess;
+}
+
+bool SqliteDataHandler::UpdateWhere(int32& OutAffected)
+{
+    DATAACCESS_SCOPE_OPERATION(UpdateWhere);
+    check(QueryStarted == true);
+    
+    OutAffected = 0;
+    if(SetParts.Num() == 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("UpdateWhere: nothing to set, call Set, Increment or Decrement first"));
         ClearQuery();
         return false;
     }
     
-    // Bind Where Paramters
-    if(!BindWhereToStatement(SqliteStatement))
+    FString SetList;
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Delete: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        DATAACCESS_SCOPE_PHASE(BuildSql);
+        SetList = FString::Join(SetParts, TEXT(","));
+    }
+    
+    sqlite3_stmt* SqliteStatement = AcquireStatement(ESqliteStatementType::UpdateWhere, GenerateWhereClause(), 0, FString(), SetList);
+    if(!SqliteStatement)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("UpdateWhere: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
         ClearQuery();
         return false;
     }
     
-    // Execute
-    if(sqlite3_step(SqliteStatement) != SQLITE_DONE)
+    // The assignments come before the where clause
+    bool bBound = true;
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Delete: error executing delete statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        DATAACCESS_SCOPE_PHASE(Bind);
+        for(int32 i = 0; i < SetParameters.Num(); ++i)
+        {
+            bBound &= BindValueToStatement(SqliteStatement, i + 1, SetParameters[i], false) == SQLITE_OK;
+        }
+    }
+    if(!bBound || !BindWhereToStatement(SqliteStatement, SetParameters.Num() + 1))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("UpdateWhere: cannot bind parameters. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        ReleaseStatement(SqliteStatement);
+        ClearQuery();
+        return false;
+    }
+    
+    if(SqliteStepTimed(SqliteStatement) != SQLITE_DONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("UpdateWhere: error executing update statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        ReleaseStatement(SqliteStatement);
         ClearQuery();
         return false;
     }
     
-    if(sqlite3_changes(DataResource->Get()) == 0)
+    OutAffected = sqlite3_changes(DataResource->Get());
+    DATAACCESS_INC_COUNTER(RowsWritten, OutAffected);
+    if(OutAffected > 0)
+    {
+        ForgetSnapshots();
+    }
+    
+    ReleaseStatement(SqliteStatement);
+    ClearQuery();
+    return true;
+}
+
+bool SqliteDataHandler::Delete()
+{
+    int32 Affected;
+    if(!Delete(Affected))
+    {
+        return false;
+    }
+    
+    if(Affected == 0)
     {
         UE_LOG(LogDataAccess, Log, TEXT("Delete: Nothing to delete"));
-        sqlite3_finalize(SqliteStatement);
+        return false;
+    }
+    return true;
+}
+
+bool SqliteDataHandler::Delete(int32& OutAffected)
+{
+    DATAACCESS_SCOPE_OPERATION(Delete);
+    check(QueryStarted == true);
+    
+    OutAffected = 0;
+    
+    // Prepare a statement and bind the Id to it
+    sqlite3_stmt* SqliteStatement = AcquireStatement(ESqliteStatementType::Delete, GenerateWhereClause());
+    if(!SqliteStatement)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Delete: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
         ClearQuery();
         return false;
     }
     
-    sqlite3_finalize(SqliteStatement);
+    // Bind Where Paramters
+    if(!BindWhereToStatement(SqliteStatement))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Delete: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        ReleaseStatement(SqliteStatement);
+        ClearQuery();
+        return false;
+    }
+    
+    // Execute
+    if(SqliteStepTimed(SqliteStatement) != SQLITE_DONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Delete: error executing delete statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        ReleaseStatement(SqliteStatement);
+        ClearQuery();
+        return false;
+    }
+    
+    ForgetSnapshots();
+    
+    OutAffected = sqlite3_changes(DataResource->Get());
+    DATAACCESS_INC_COUNTER(RowsWritten, OutAffected);
+    
+    ReleaseStatement(SqliteStatement);
     ClearQuery();
     return true;
 }
 
 bool SqliteDataHandler::Count(int32& OutCount)
 {
+    DATAACCESS_SCOPE_OPERATION(Count);
     check(QueryStarted == true);
 
     OutCount = 0;
-    FString SqlStatement(FString::Printf(TEXT("SELECT COUNT(Id) FROM %s %s;"), *(SourceClass->GetName()), *(GenerateWhereClause())));
-
     // Preare statement and bind Id to it
-    sqlite3_stmt* SqliteStatement;
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*SqlStatement), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    sqlite3_stmt* SqliteStatement = AcquireStatement(ESqliteStatementType::Count, GenerateWhereClause());
+    if(!SqliteStatement)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Count: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("Count: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
         ClearQuery();
         return false;
     }
@@ -393,14 +785,14 @@ bool SqliteDataHandler::Count(int32& OutCount)
     // Bind Where Paramters
     if(!BindWhereToStatement(SqliteStatement))
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Count: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("Count: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
+        ReleaseStatement(SqliteStatement);
         ClearQuery();
         return false;
     }
     
     // Execute
-    int32 ResultCode = sqlite3_step(SqliteStatement);
+    int32 ResultCode = SqliteStepTimed(SqliteStatement);
     if(ResultCode == SQLITE_DONE)
     {
 		OutCount = 0;
@@ -408,7 +800,7 @@ bool SqliteDataHandler::Count(int32& OutCount)
     else if(ResultCode != SQLITE_ROW)
     {
         UE_LOG(LogDataAccess, Error, TEXT("Count: error executing select statement."));
-        sqlite3_finalize(SqliteStatement);
+        ReleaseStatement(SqliteStatement);
         ClearQuery();
         return false;
     }
@@ -418,66 +810,107 @@ bool SqliteDataHandler::Count(int32& OutCount)
 		OutCount = sqlite3_column_int(SqliteStatement, 0);
 	}
 	
-    sqlite3_finalize(SqliteStatement);
+    ReleaseStatement(SqliteStatement);
     ClearQuery();
     return true;
 }
 
+bool SqliteDataHandler::Sum(FString FieldName, FDataValue& OutValue)
+{
+    return AggregateValue(TEXT("SUM"), FieldName, OutValue);
+}
+
+bool SqliteDataHandler::Min(FString FieldName, FDataValue& OutValue)
+{
+    return AggregateValue(TEXT("MIN"), FieldName, OutValue);
+}
+
+bool SqliteDataHandler::Max(FString FieldName, FDataValue& OutValue)
+{
+    return AggregateValue(TEXT("MAX"), FieldName, OutValue);
+}
+
+bool SqliteDataHandler::Avg(FString FieldName, FDataValue& OutValue)
+{
+    return AggregateValue(TEXT("AVG"), FieldName, OutValue);
+}
+
+bool SqliteDataHandler::Sum(FString FieldName, TArray<FDataAggregateGroup>& OutGroups)
+{
+    return Aggregate(TEXT("SUM"), FieldName, OutGroups);
+}
+
+bool SqliteDataHandler::Min(FString FieldName, TArray<FDataAggregateGroup>& OutGroups)
+{
+    return Aggregate(TEXT("MIN"), FieldName, OutGroups);
+}
+
+bool SqliteDataHandler::Max(FString FieldName, TArray<FDataAggregateGroup>& OutGroups)
+{
+    return Aggregate(TEXT("MAX"), FieldName, OutGroups);
+}
+
+bool SqliteDataHandler::Avg(FString FieldName, TArray<FDataAggregateGroup>& OutGroups)
+{
+    return Aggregate(TEXT("AVG"), FieldName, OutGroups);
+}
+
 bool SqliteDataHandler::First(UObject* const OutObj)
 {
+    DATAACCESS_SCOPE_OPERATION(First);
     check(OutObj);
     check(QueryStarted == true);
     
-    // Build columns for select statement
-    FString Columns;
-    for(TFieldIterator<UProperty> Itr(SourceClass); Itr; ++Itr)
+    if(bSelectFailed)
     {
-        UProperty* Property = *Itr;
-
-		if (!Property->HasMetaData("SaveToDatabase") || !Property->GetMetaData("SaveToDatabase").ToUpper().Equals("TRUE"))
-		{
-			continue;
-		}
-		
-        Columns += FString::Printf(TEXT("%s,"), *(Property->GetName()));
+        UE_LOG(LogDataAccess, Error, TEXT("First: the selected fields cannot be read."));
+        ClearQuery();
+        return false;
     }
-    Columns.RemoveFromEnd(",", ESearchCase::IgnoreCase);
     
-    FString SqlStatement(FString::Printf(TEXT("SELECT %s FROM %s %s;"), *Columns, *(SourceClass->GetName()), *(GenerateWhereClause())));
-
+    // Snapshots hold every column, a Select must only write the selected ones so it always reads the row
+    int32 WhereId;
+    if(DataResource->IsIdentityMap() && SelectMask == 0 && QueryOffset == 0 && GetWhereId(WhereId) && DataResource->GetSnapshots().Load(*SourceSchema, WhereId, OutObj))
+    {
+        ClearQuery();
+        return true;
+    }
+    
+    // Only one row is read, let sqlite stop looking after it
+    QueryLimit = 1;
+    
     // Preare statement and bind Id to it
-    sqlite3_stmt* SqliteStatement;
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*SqlStatement), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    sqlite3_stmt* SqliteStatement = AcquireStatement(ESqliteStatementType::Select, GenerateWhereClause(), SelectMask, GenerateOrderClause());
+    if(!SqliteStatement)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("First: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("First: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
         ClearQuery();
         return false;
     }
     
     // Bind Where Paramters
-    if(!BindWhereToStatement(SqliteStatement))
+    if(!BindSelectToStatement(SqliteStatement))
     {
-        UE_LOG(LogDataAccess, Error, TEXT("First: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("First: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
+        ReleaseStatement(SqliteStatement);
         ClearQuery();
         return false;
     }
     
     // Execute
-    int32 ResultCode = sqlite3_step(SqliteStatement);
+    int32 ResultCode = SqliteStepTimed(SqliteStatement);
     
     if(ResultCode == SQLITE_DONE)
     {
         //UE_LOG(LogDataAccess, Log, TEXT("First: nothing selected."));
-        sqlite3_finalize(SqliteStatement);
+        ReleaseStatement(SqliteStatement);
         ClearQuery();
         return false;
     }
     else if(ResultCode != SQLITE_ROW)
     {
         UE_LOG(LogDataAccess, Error, TEXT("First: error executing select statement."));
-        sqlite3_finalize(SqliteStatement);
+        ReleaseStatement(SqliteStatement);
         ClearQuery();
         return false;
     }
@@ -486,18 +919,23 @@ bool SqliteDataHandler::First(UObject* const OutObj)
     if(!BindStatementToObject(SqliteStatement, OutObj))
     {
         UE_LOG(LogDataAccess, Error, TEXT("First: error binding results."));
-        sqlite3_finalize(SqliteStatement);
+        ReleaseStatement(SqliteStatement);
         ClearQuery();
         return false;
     }
+    if(SelectMask == 0)
+    {
+        StoreSnapshot(OutObj);
+    }
     
-    sqlite3_finalize(SqliteStatement);
+    ReleaseStatement(SqliteStatement);
     ClearQuery();
     return true;
 }
 
 bool SqliteDataHandler::Get(TArray<UObject*>& OutObjs)
 {
+    DATAACCESS_SCOPE_OPERATION(Get);
     check(QueryStarted == true);
 
     if(OutObjs.Num() <= 0)
@@ -508,51 +946,40 @@ bool SqliteDataHandler::Get(TArray<UObject*>& OutObjs)
         return false;
     }
     
-    // Build columns for select statement
-    FString Columns;
-    for(TFieldIterator<UProperty> Itr(SourceClass); Itr; ++Itr)
+    if(bSelectFailed)
     {
-        UProperty* Property = *Itr;
-		
-		// All properties to save to the database require the SaveToDatabase attribute
-		if (!Property->HasMetaData("SaveToDatabase") || !Property->GetMetaData("SaveToDatabase").ToUpper().Equals("TRUE"))
-		{
-			continue;
-		}
-
-        Columns += FString::Printf(TEXT("%s,"), *(Property->GetName()));
+        UE_LOG(LogDataAccess, Error, TEXT("Get: the selected fields cannot be read."));
+        OutObjs.Empty();
+        ClearQuery();
+        return false;
     }
-    Columns.RemoveFromEnd(",", ESearchCase::IgnoreCase);
-    
-    FString SqlStatement(FString::Printf(TEXT("SELECT %s FROM %s %s;"), *Columns, *(SourceClass->GetName()), *(GenerateWhereClause())));
     
     // Preare statement and bind Id to it
-    sqlite3_stmt* SqliteStatement;
-    if(sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*SqlStatement), FCString::Strlen(*SqlStatement), &SqliteStatement, nullptr) != SQLITE_OK)
+    sqlite3_stmt* SqliteStatement = AcquireStatement(ESqliteStatementType::Select, GenerateWhereClause(), SelectMask, GenerateOrderClause());
+    if(!SqliteStatement)
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Get: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("Get: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
         OutObjs.Empty();
         ClearQuery();
         return false;
     }
     
     // Bind Where Paramters
-    if(!BindWhereToStatement(SqliteStatement))
+    if(!BindSelectToStatement(SqliteStatement))
     {
-        UE_LOG(LogDataAccess, Error, TEXT("Get: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-        sqlite3_finalize(SqliteStatement);
+        UE_LOG(LogDataAccess, Error, TEXT("Get: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
+        ReleaseStatement(SqliteStatement);
         OutObjs.Empty();
         ClearQuery();
         return false;
     }
     
     // Execute
-    int32 ResultCode = sqlite3_step(SqliteStatement);
+    int32 ResultCode = SqliteStepTimed(SqliteStatement);
     if(ResultCode == SQLITE_DONE)
     {
         //UE_LOG(LogDataAccess, Log, TEXT("Get: nothing selected."));
-        sqlite3_finalize(SqliteStatement);
+        ReleaseStatement(SqliteStatement);
         OutObjs.Empty();
         ClearQuery();
         return false;
@@ -560,7 +987,7 @@ bool SqliteDataHandler::Get(TArray<UObject*>& OutObjs)
     else if(ResultCode != SQLITE_ROW)
     {
         UE_LOG(LogDataAccess, Error, TEXT("Get: error executing select statement."));
-        sqlite3_finalize(SqliteStatement);
+        ReleaseStatement(SqliteStatement);
         OutObjs.Empty();
         ClearQuery();
         return false;
@@ -579,371 +1006,1105 @@ bool SqliteDataHandler::Get(TArray<UObject*>& OutObjs)
         if(!BindStatementToObject(SqliteStatement, OutObjs[CurrentIndex]))
         {
             UE_LOG(LogDataAccess, Error, TEXT("Get: error binding results."));
-            sqlite3_finalize(SqliteStatement);
+            ReleaseStatement(SqliteStatement);
             ClearQuery();
             OutObjs.Empty();
             return false;
         }
-        ResultCode = sqlite3_step(SqliteStatement);
+        if(SelectMask == 0)
+        {
+            StoreSnapshot(OutObjs[CurrentIndex]);
+        }
+        ResultCode = SqliteStepTimed(SqliteStatement);
         ++CurrentIndex;
     }
     
-    sqlite3_finalize(SqliteStatement);
+    ReleaseStatement(SqliteStatement);
     ClearQuery();
     return true;
 }
 
-bool SqliteDataHandler::ExecuteQuery(FString Query, TArray< TSharedPtr<FJsonValue> >& JsonArray)
-{
-	// A query cannot be started before a manual query execution 
-	check(QueryStarted == false);
-	
-	JsonArray.Empty();
-
-	// Preare statement and bind Id to it
-	sqlite3_stmt* SqliteStatement;
-	if (sqlite3_prepare_v2(DataResource->Get(), TCHAR_TO_UTF8(*Query), FCString::Strlen(*Query), &SqliteStatement, nullptr) != SQLITE_OK)
-	{
-		UE_LOG(LogDataAccess, Error, TEXT("Get: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-		sqlite3_finalize(SqliteStatement);
-		ClearQuery();
-		return false;
-	}
-
-	// Bind Where Paramters
-	if (!BindWhereToStatement(SqliteStatement))
-	{
-		UE_LOG(LogDataAccess, Error, TEXT("Get: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-		sqlite3_finalize(SqliteStatement);
-		ClearQuery();
-		return false;
-	}
-
-	// Execute
-	int32 ResultCode = sqlite3_step(SqliteStatement);
-	if (ResultCode == SQLITE_DONE)
-	{
-		//UE_LOG(LogDataAccess, Log, TEXT("Get: nothing selected."));
-		sqlite3_finalize(SqliteStatement);
-		ClearQuery();
-		return false;
-	}
-	else if (ResultCode != SQLITE_ROW)
-	{
-		UE_LOG(LogDataAccess, Error, TEXT("Get: error executing select statement."));
-		sqlite3_finalize(SqliteStatement);
-		ClearQuery();
-		return false;
-	}
-
-	int32 CurrentIndex = 0;
-	// Bind the results to the passed in object
-	while (ResultCode != SQLITE_DONE)
-	{
-		TSharedPtr< FJsonValue > JsonValue;
-		if (!BindStatementToArray(SqliteStatement, JsonValue))
-		{
-			UE_LOG(LogDataAccess, Error, TEXT("Get: error binding results."));
-			sqlite3_finalize(SqliteStatement);
-			JsonArray.Empty();
-			ClearQuery();
-			return false;
-		}
-		JsonArray.Add(JsonValue);
-
-		ResultCode = sqlite3_step(SqliteStatement);
-		++CurrentIndex;
-	}
-
-	sqlite3_finalize(SqliteStatement);
-	ClearQuery();
-	return true;
-}
-
-void SqliteDataHandler::ClearQuery()
-{
-    QueryStarted = false;
-    SourceClass = nullptr;
-    QueryParts.Empty();
-    QueryParameters.Empty();
-}
-
-FString SqliteDataHandler::GenerateWhereClause()
+bool SqliteDataHandler::Get(TArray<UObject*>& OutObjs, FDataObjectPool* ObjectPool)
 {
-    FString WhereClause("");
-    if(QueryParts.Num() > 0)
+    DATAACCESS_SCOPE_OPERATION(Get);
+    check(QueryStarted == true);
+    
+    OutObjs.Reset();
+    UClass* RowClass = SourceClass;
+    TSharedPtr<IDataCursor> Cursor = OpenCursor();
+    if(!Cursor.IsValid())
     {
-        WhereClause = "WHERE " + FString::Join(QueryParts, TEXT(" "));
+        return false;
     }
     
-    return WhereClause;
-}
-
-bool SqliteDataHandler::BindWhereToStatement(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex)
-{
     bool bSuccess = true;
-    // Binding index is 1 based not 0 based
-    for(auto Itr = QueryParameters.CreateConstIterator(); Itr; ++Itr)
+    while(bSuccess && Cursor->Next())
     {
-        const TPair<UClass*, FString> CurrentParameter = *Itr;
-    
-        if(CurrentParameter.Key->GetName() == UByteProperty::StaticClass()->GetName())
+        UObject* RowObj = ObjectPool ? ObjectPool->Acquire(RowClass) : NewObject<UObject>(GetTransientPackage(), RowClass);
+        OutObjs.Add(RowObj);
+        
+        if(!Cursor->Read(RowObj))
         {
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind byte. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            UE_LOG(LogDataAccess, Error, TEXT("Get: error binding results."));
+            bSuccess = false;
         }
-        else if(CurrentParameter.Key->GetName() == UInt8Property::StaticClass()->GetName())
+    }
+    
+    if(!bSuccess || Cursor->HasError())
+    {
+        if(ObjectPool)
         {
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind int8. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            ObjectPool->Release(OutObjs);
         }
-        else if(CurrentParameter.Key->GetName() == UInt16Property::StaticClass()->GetName())
+        OutObjs.Empty();
+        return false;
+    }
+    
+    return true;
+}
+
+TSharedPtr<IDataCursor> SqliteDataHandler::OpenCursor()
+{
+    check(QueryStarted == true);
+    
+    if(bSelectFailed)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("OpenCursor: the selected fields cannot be read."));
+        ClearQuery();
+        return nullptr;
+    }
+    
+    sqlite3_stmt* SqliteStatement = AcquireStatement(ESqliteStatementType::Select, GenerateWhereClause(), SelectMask, GenerateOrderClause());
+    if(!SqliteStatement)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("OpenCursor: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
+        ClearQuery();
+        return nullptr;
+    }
+    
+    // Bind Where Paramters.  The cursor outlives this query, so sqlite keeps its own copy of bound text.
+    if(!BindSelectToStatement(SqliteStatement, true))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("OpenCursor: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
+        ReleaseStatement(SqliteStatement);
+        ClearQuery();
+        return nullptr;
+    }
+    
+    TSharedPtr<IDataCursor> Cursor = MakeShareable(new SqliteDataCursor(DataResource, SourceSchema.ToSharedRef(), SqliteStatement, SelectMask));
+    ClearQuery();
+    return Cursor;
+}
+
+bool SqliteDataHandler::Iterate(TFunctionRef<bool(UObject*)> Callback, UObject* const ReuseObj)
+{
+    check(QueryStarted == true);
+    check(!ReuseObj || ReuseObj->GetClass() == SourceClass);
+    
+    UClass* RowClass = SourceClass;
+    TSharedPtr<IDataCursor> Cursor = OpenCursor();
+    if(!Cursor.IsValid())
+    {
+        return false;
+    }
+    
+    while(Cursor->Next())
+    {
+        UObject* RowObj = ReuseObj ? ReuseObj : NewObject<UObject>(GetTransientPackage(), RowClass);
+        if(!Cursor->Read(RowObj))
         {
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind int16. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            UE_LOG(LogDataAccess, Error, TEXT("Iterate: error binding results."));
+            return false;
         }
-        else if(CurrentParameter.Key->GetName() == UIntProperty::StaticClass()->GetName())
+        
+        if(!Callback(RowObj))
         {
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind int32. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            break;
         }
-        else if(CurrentParameter.Key->GetName() == UInt64Property::StaticClass()->GetName())
+    }
+    
+    return !Cursor->HasError();
+}
+
+bool SqliteDataHandler::EnsureTable()
+{
+    check(QueryStarted == true);
+    
+    const FSqliteClassSchema& Schema = *SourceSchema;
+    sqlite3* Database = DataResource->Get();
+    
+    // Read the columns of the existing table, if any
+    TMap<FString, FString> ExistingColumns;
+    sqlite3_stmt* SqliteStatement = nullptr;
+    FString TableInfoSql = FString::Printf(TEXT("PRAGMA table_info(%s);"), *(Schema.TableName));
+    int32 ByteCount;
+    const ANSICHAR* Utf8 = Scratch->ToUtf8(TableInfoSql, ByteCount);
+    if(sqlite3_prepare_v2(Database, Utf8, ByteCount, &SqliteStatement, nullptr) != SQLITE_OK)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("EnsureTable: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(Database)));
+        sqlite3_finalize(SqliteStatement);
+        ClearQuery();
+        return false;
+    }
+    
+    while(SqliteStepTimed(SqliteStatement) == SQLITE_ROW)
+    {
+        ExistingColumns.Add(UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, 1)), UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, 2)));
+    }
+    sqlite3_finalize(SqliteStatement);
+    
+    if(!BeginTransaction(EDataTransactionMode::Immediate))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("EnsureTable: cannot begin transaction."));
+        ClearQuery();
+        return false;
+    }
+    
+    bool bSuccess = true;
+    bool bTypeMismatch = false;
+    if(ExistingColumns.Num() == 0)
+    {
+        UE_LOG(LogDataAccess, Log, TEXT("EnsureTable: creating table %s"), *(Schema.TableName));
+        bSuccess = ExecuteStatement(*Schema.BuildCreateTableSql());
+    }
+    else
+    {
+        for(const FSqliteColumn& Column : Schema.Columns)
         {
-            if(sqlite3_bind_int64(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
+            if(!Column.SqlType)
             {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind int64. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
+                continue;
             }
-        }
-        else if(CurrentParameter.Key->GetName() == UUInt16Property::StaticClass()->GetName())
-        {
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
+            
+            const FString* ExistingType = ExistingColumns.Find(Column.Name);
+            if(!ExistingType)
             {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind uint16. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
+                UE_LOG(LogDataAccess, Log, TEXT("EnsureTable: adding column %s to table %s"), *(Column.Name), *(Schema.TableName));
+                bSuccess = ExecuteStatement(*FString::Printf(TEXT("ALTER TABLE %s ADD COLUMN %s %s;"), *(Schema.TableName), *(Column.Name), Column.SqlType));
             }
-        }
-        else if(CurrentParameter.Key->GetName() == UUInt32Property::StaticClass()->GetName())
-        {
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
+            else if(!ExistingType->Equals(Column.SqlType, ESearchCase::IgnoreCase))
             {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind uint32. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
+                // sqlite cannot change a column's type, the rest of the table is still brought up to date
+                UE_LOG(LogDataAccess, Error, TEXT("EnsureTable: column %s of table %s is declared %s, expected %s"), *(Column.Name), *(Schema.TableName), **ExistingType, Column.SqlType);
+                bTypeMismatch = true;
             }
+            
+            if(!bSuccess)
+            {
+                break;
+            }
+        }
+    }
+    
+    TArray<FString> SupportStatements;
+    Schema.BuildSupportSql(SupportStatements);
+    for(int32 i = 0; bSuccess && i < SupportStatements.Num(); ++i)
+    {
+        bSuccess = ExecuteStatement(*SupportStatements[i]);
+    }
+    
+    bSuccess = bSuccess && Commit();
+    if(!bSuccess)
+    {
+        Rollback();
+    }
+    
+    ClearQuery();
+    return bSuccess && !bTypeMismatch;
+}
+
+bool SqliteDataHandler::ExecuteQuery(FString Query, TArray< TSharedPtr<FJsonValue> >& JsonArray)
+{
+    DATAACCESS_SCOPE_OPERATION(ExecuteQuery);
+	// A query cannot be started before a manual query execution 
+	check(QueryStarted == false);
+	
+	JsonArray.Empty();
+
+	// The query can write anything, no snapshot can be trusted afterwards
+	if(DataResource->UsesSnapshots())
+	{
+		DataResource->GetSnapshots().Empty();
+	}
+
+	// Preare statement and bind Id to it
+	sqlite3_stmt* SqliteStatement;
+	int32 ByteCount;
+	const ANSICHAR* Utf8 = Scratch->ToUtf8(Query, ByteCount);
+	if (sqlite3_prepare_v2(DataResource->Get(), Utf8, ByteCount, &SqliteStatement, nullptr) != SQLITE_OK)
+	{
+		UE_LOG(LogDataAccess, Error, TEXT("Get: cannot prepare sqlite statement. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+		sqlite3_finalize(SqliteStatement);
+		ClearQuery();
+		return false;
+	}
+
+	// Bind Where Paramters
+	if (!BindWhereToStatement(SqliteStatement))
+	{
+		UE_LOG(LogDataAccess, Error, TEXT("Get: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+		sqlite3_finalize(SqliteStatement);
+		ClearQuery();
+		return false;
+	}
+
+	// Execute
+	int32 ResultCode = SqliteStepTimed(SqliteStatement);
+	if (ResultCode == SQLITE_DONE)
+	{
+		//UE_LOG(LogDataAccess, Log, TEXT("Get: nothing selected."));
+		sqlite3_finalize(SqliteStatement);
+		ClearQuery();
+		return false;
+	}
+	else if (ResultCode != SQLITE_ROW)
+	{
+		UE_LOG(LogDataAccess, Error, TEXT("Get: error executing select statement."));
+		sqlite3_finalize(SqliteStatement);
+		ClearQuery();
+		return false;
+	}
+
+	int32 CurrentIndex = 0;
+	// Bind the results to the passed in object
+	while (ResultCode != SQLITE_DONE)
+	{
+		TSharedPtr< FJsonValue > JsonValue;
+		if (!BindStatementToArray(SqliteStatement, JsonValue))
+		{
+			UE_LOG(LogDataAccess, Error, TEXT("Get: error binding results."));
+			sqlite3_finalize(SqliteStatement);
+			JsonArray.Empty();
+			ClearQuery();
+			return false;
+		}
+		JsonArray.Add(JsonValue);
+
+		ResultCode = SqliteStepTimed(SqliteStatement);
+		++CurrentIndex;
+	}
+
+	sqlite3_finalize(SqliteStatement);
+	ClearQuery();
+	return true;
+}
+
+bool SqliteDataHandler::BeginTransaction(EDataTransactionMode Mode)
+{
+    if(TransactionDepth > 0 || sqlite3_get_autocommit(DataResource->Get()) == 0)
+    {
+        // Already inside a transaction, nest with a savepoint
+        if(!ExecuteStatement(*FString::Printf(TEXT("SAVEPOINT %s;"), *GetSavepointName(TransactionDepth))))
+        {
+            return false;
         }
-        else if(CurrentParameter.Key->GetName() == UUInt64Property::StaticClass()->GetName())
+        
+        if(TransactionDepth == 0)
+        {
+            bOwnsTransaction = false;
+        }
+        ++TransactionDepth;
+        return true;
+    }
+    
+    const TCHAR* BeginStatement = TEXT("BEGIN DEFERRED;");
+    switch(Mode)
+    {
+    case EDataTransactionMode::Immediate:
+        BeginStatement = TEXT("BEGIN IMMEDIATE;");
+        break;
+    case EDataTransactionMode::Exclusive:
+        BeginStatement = TEXT("BEGIN EXCLUSIVE;");
+        break;
+    default:
+        break;
+    }
+    
+    if(!ExecuteStatement(BeginStatement))
+    {
+        return false;
+    }
+    
+    bOwnsTransaction = true;
+    TransactionDepth = 1;
+    return true;
+}
+
+bool SqliteDataHandler::Commit()
+{
+    if(TransactionDepth <= 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Commit: no transaction is open"));
+        return false;
+    }
+    
+    // A failed commit leaves the transaction open so the caller can retry or roll back
+    bool bSuccess = (TransactionDepth == 1 && bOwnsTransaction) ? ExecuteStatement(TEXT("COMMIT;")) : ExecuteStatement(*FString::Printf(TEXT("RELEASE %s;"), *GetSavepointName(TransactionDepth - 1)));
+    if(bSuccess)
+    {
+        --TransactionDepth;
+    }
+    
+    return bSuccess;
+}
+
+bool SqliteDataHandler::Rollback()
+{
+    if(TransactionDepth <= 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Rollback: no transaction is open"));
+        return false;
+    }
+    
+    bool bSuccess;
+    if(TransactionDepth == 1 && bOwnsTransaction)
+    {
+        bSuccess = ExecuteStatement(TEXT("ROLLBACK;"));
+    }
+    else
+    {
+        // Rolling back to a savepoint keeps it on the stack, release it as well
+        const FString SavepointName = GetSavepointName(TransactionDepth - 1);
+        bSuccess = ExecuteStatement(*FString::Printf(TEXT("ROLLBACK TO %s; RELEASE %s;"), *SavepointName, *SavepointName));
+    }
+    
+    // Snapshots taken inside of the rolled back level no longer match the database
+    if(DataResource->UsesSnapshots())
+    {
+        DataResource->GetSnapshots().Empty();
+    }
+    
+    // Whether or not sqlite could roll back, this level is gone
+    --TransactionDepth;
+    return bSuccess;
+}
+
+void SqliteDataHandler::ClearQuery()
+{
+    QueryStarted = false;
+    SourceClass = nullptr;
+    SourceSchema.Reset();
+    QueryParts.Reset();
+    QueryParameters.Reset();
+    SelectMask = 0;
+    bSelectFailed = false;
+    OrderParts.Reset();
+    GroupParts.Reset();
+    SetParts.Reset();
+    SetParameters.Reset();
+    QueryLimit = INDEX_NONE;
+    QueryOffset = 0;
+    KeysetParts.Reset();
+    KeysetValues.Reset();
+    CompiledShape.Reset();
+    
+    // Every statement of the finished query has been released and unbound
+    Scratch->Reset();
+}
+
+sqlite3_stmt* SqliteDataHandler::AcquireStatement(ESqliteStatementType::Type StatementType, const FString& WhereClause, uint64 ColumnMask, const FString& OrderClause, const FString& ColumnList)
+{
+    check(SourceSchema.IsValid());
+    
+    FSqliteStatementKey Key(SourceClass, StatementType, WhereClause, ColumnMask, OrderClause, ColumnList);
+    sqlite3* Database = DataResource->Get();
+    SqliteStatementCache* StatementCache = &DataResource->GetStatementCache();
+    
+    // Reads go to this thread's reader unless a transaction is open here and they have to see its writes
+    if((StatementType == ESqliteStatementType::Select || StatementType == ESqliteStatementType::Count || StatementType == ESqliteStatementType::Aggregate) && TransactionDepth == 0)
+    {
+        FSqliteReaderConnection* Reader = DataResource->GetReader();
+        if(Reader)
+        {
+            Database = Reader->Database;
+            StatementCache = &Reader->StatementCache;
+        }
+    }
+    
+    // Timestamp reads repeat the where clause of the write they follow and are not counted again
+    SqliteQueryPlanAdvisor& Advisor = DataResource->GetQueryPlanAdvisor();
+    if(Advisor.IsEnabled() && !WhereClause.IsEmpty() &&
+       (StatementType == ESqliteStatementType::Select || StatementType == ESqliteStatementType::Count || StatementType == ESqliteStatementType::Aggregate ||
+        StatementType == ESqliteStatementType::Update || StatementType == ESqliteStatementType::UpdateReturning || StatementType == ESqliteStatementType::UpdateWhere ||
+        StatementType == ESqliteStatementType::Delete) &&
+       Advisor.Observe(SourceSchema->TableName, WhereClause))
+    {
+        Advisor.Explain(Database, SourceSchema->TableName, WhereClause, GenerateStatementSql(StatementType, WhereClause, ColumnMask, OrderClause, ColumnList));
+    }
+    
+    sqlite3_stmt* SqliteStatement = StatementCache->Checkout(Key);
+    if(SqliteStatement)
+    {
+        return SqliteStatement;
+    }
+    
+    FString Sql = GenerateStatementSql(StatementType, WhereClause, ColumnMask, OrderClause, ColumnList);
+    
+    DATAACCESS_SCOPE_PHASE(Prepare);
+    return StatementCache->Prepare(Database, Key, Sql);
+}
+
+void SqliteDataHandler::ReleaseStatement(sqlite3_stmt* const SqliteStatement)
+{
+    DataResource->ReturnStatement(SqliteStatement);
+}
+
+sqlite3* SqliteDataHandler::GetReadDatabase() const
+{
+    FSqliteReaderConnection* Reader = TransactionDepth == 0 ? DataResource->GetReader() : nullptr;
+    return Reader ? Reader->Database : DataResource->Get();
+}
+
+FString SqliteDataHandler::GenerateStatementSql(ESqliteStatementType::Type StatementType, const FString& WhereClause, uint64 ColumnMask, const FString& OrderClause, const FString& ColumnList) const
+{
+    DATAACCESS_SCOPE_PHASE(BuildSql);
+    const FSqliteClassSchema& Schema = *SourceSchema;
+    switch(StatementType)
+    {
+    case ESqliteStatementType::Insert:
+        return FString::Printf(TEXT("INSERT INTO %s %s VALUES %s;"), *(Schema.TableName), *(Schema.InsertColumnList), *(Schema.InsertValueList));
+    case ESqliteStatementType::InsertReturning:
+        // Setting the timestamps in the insert itself lets RETURNING report them.  'now' is fixed for the whole step so triggers write the same values.
+        return FString::Printf(TEXT("INSERT INTO %s %s VALUES %s RETURNING Id, CreateTimestamp, LastUpdateTimestamp;"), *(Schema.TableName), *(Schema.InsertReturningColumnList), *(Schema.InsertReturningValueList));
+    case ESqliteStatementType::InsertTimestamps:
+        return FString::Printf(TEXT("SELECT CreateTimestamp, LastUpdateTimestamp FROM %s WHERE Id = ?;"), *(Schema.TableName));
+    case ESqliteStatementType::Update:
+        return FString::Printf(TEXT("UPDATE %s SET %s %s;"), *(Schema.TableName), ColumnMask ? *Schema.BuildUpdateSetList(ColumnMask, false) : *(Schema.UpdateSetList), *WhereClause);
+    case ESqliteStatementType::UpdateReturning:
+        return FString::Printf(TEXT("UPDATE %s SET %s %s RETURNING LastUpdateTimestamp;"), *(Schema.TableName), ColumnMask ? *Schema.BuildUpdateSetList(ColumnMask, true) : *(Schema.UpdateReturningSetList), *WhereClause);
+    case ESqliteStatementType::UpdateTimestamp:
+        return FString::Printf(TEXT("SELECT DISTINCT LastUpdateTimestamp FROM %s %s;"), *(Schema.TableName), *WhereClause);
+    case ESqliteStatementType::UpdateWhere:
+        return FString::Printf(TEXT("UPDATE %s SET %s %s;"), *(Schema.TableName), *ColumnList, *WhereClause);
+    case ESqliteStatementType::Delete:
+        return FString::Printf(TEXT("DELETE FROM %s %s;"), *(Schema.TableName), *WhereClause);
+    case ESqliteStatementType::Count:
+        return FString::Printf(TEXT("SELECT COUNT(Id) FROM %s %s;"), *(Schema.TableName), *WhereClause);
+    case ESqliteStatementType::Select:
+        return FString::Printf(TEXT("SELECT %s FROM %s %s %s;"), ColumnMask ? *Schema.BuildSelectColumnList(ColumnMask) : *(Schema.SelectColumnList), *(Schema.TableName), *WhereClause, *OrderClause);
+    case ESqliteStatementType::Aggregate:
+        return FString::Printf(TEXT("SELECT %s FROM %s %s %s;"), *ColumnList, *(Schema.TableName), *WhereClause, *OrderClause);
+    }
+    
+    check(false);
+    return FString();
+}
+
+FString SqliteDataHandler::GenerateWhereClause()
+{
+    DATAACCESS_SCOPE_PHASE(BuildSql);
+    FString WhereClause("");
+    if(CompiledShape.IsValid())
+    {
+        WhereClause = CompiledShape->WhereClause;
+    }
+    else if(QueryParts.Num() > 0)
+    {
+        WhereClause = "WHERE " + FString::Join(QueryParts, TEXT(" "));
+    }
+    
+    if(KeysetValues.Num() == 0)
+    {
+        return WhereClause;
+    }
+    
+    // Rows after the keyset (A, B, Id) in order: A > ? OR (A = ? AND (B > ? OR (B = ? AND Id > ?))).  The leading
+    // A >= ? is implied by it but lets sqlite start an index range on A.
+    const int32 NumKeys = KeysetParts.Num() / 2;
+    FString Keyset;
+    for(int32 i = NumKeys - 1; i >= 0; --i)
+    {
+        const FString& Field = KeysetParts[i * 2];
+        const TCHAR* Operator = KeysetParts[i * 2 + 1] == TEXT("DESC") ? TEXT("<") : TEXT(">");
+        Keyset = i == NumKeys - 1 ?
+            FString::Printf(TEXT("%s %s ?"), *Field, Operator) :
+            FString::Printf(TEXT("( %s %s ? OR ( %s = ? AND %s ) )"), *Field, Operator, *Field, *Keyset);
+    }
+    if(NumKeys > 1)
+    {
+        Keyset = FString::Printf(TEXT("%s %s= ? AND %s"), *(KeysetParts[0]), KeysetParts[1] == TEXT("DESC") ? TEXT("<") : TEXT(">"), *Keyset);
+    }
+    
+    return WhereClause.IsEmpty() ? "WHERE " + Keyset : FString::Printf(TEXT("WHERE ( %s ) AND %s"), *WhereClause.Mid(6), *Keyset);
+}
+
+const TArray<FString>& SqliteDataHandler::GetQueryParts() const
+{
+    return CompiledShape.IsValid() ? CompiledShape->Parts : QueryParts;
+}
+
+const TArray<FString>& SqliteDataHandler::GetOrderParts() const
+{
+    return CompiledShape.IsValid() ? CompiledShape->OrderParts : OrderParts;
+}
+
+const TArray<FString>& SqliteDataHandler::GetGroupParts() const
+{
+    return CompiledShape.IsValid() ? CompiledShape->GroupParts : GroupParts;
+}
+
+void SqliteDataHandler::GetTotalOrderParts(TArray<FString>& OutParts) const
+{
+    OutParts = GetOrderParts();
+    if(OutParts.Num() == 0)
+    {
+        return;
+    }
+    
+    // The Id breaks ties so rows sharing the ordered values are neither skipped nor repeated between pages
+    for(int32 i = 0; i < OutParts.Num(); i += 2)
+    {
+        if(OutParts[i] == TEXT("Id"))
+        {
+            return;
+        }
+    }
+    OutParts.Add("Id");
+    OutParts.Add("ASC");
+}
+
+FString SqliteDataHandler::GenerateOrderClause(bool bBreakTiesById) const
+{
+    DATAACCESS_SCOPE_PHASE(BuildSql);
+    TArray<FString> Parts;
+    if(!bBreakTiesById)
+    {
+        Parts = GetOrderParts();
+    }
+    else if(KeysetParts.Num() > 0)
+    {
+        Parts = KeysetParts;
+    }
+    else
+    {
+        GetTotalOrderParts(Parts);
+    }
+    
+    FString OrderClause("");
+    for(int32 i = 0; i < Parts.Num(); i += 2)
+    {
+        OrderClause += FString::Printf(TEXT("%s%s %s"), i == 0 ? TEXT("ORDER BY ") : TEXT(","), *(Parts[i]), *(Parts[i + 1]));
+    }
+    
+    // Both are bound so every page of a query shares one statement.  LIMIT -1 is no limit.
+    if(QueryLimit != INDEX_NONE || QueryOffset > 0)
+    {
+        OrderClause += OrderClause.IsEmpty() ? TEXT("LIMIT ?") : TEXT(" LIMIT ?");
+        if(QueryOffset > 0)
+        {
+            OrderClause += " OFFSET ?";
+        }
+    }
+    
+    return OrderClause;
+}
+
+bool SqliteDataHandler::Aggregate(const TCHAR* Function, const FString& FieldName, TArray<FDataAggregateGroup>& OutGroups)
+{
+    DATAACCESS_SCOPE_OPERATION(Aggregate);
+    check(QueryStarted == true);
+    
+    OutGroups.Reset();
+    int32 ColumnIndex = SourceSchema->FindColumn(FieldName);
+    if(ColumnIndex == INDEX_NONE || SourceSchema->Columns[ColumnIndex].SqlType == nullptr || FCString::Strcmp(SourceSchema->Columns[ColumnIndex].SqlType, TEXT("BLOB")) == 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("%s: FieldName \"%s\" does not exist in UClass \"%s\" or cannot be aggregated"), Function, *(FieldName), *(SourceClass->GetName()));
+        ClearQuery();
+        return false;
+    }
+    
+    const TArray<FString>& Groups = GetGroupParts();
+    FString ColumnList;
+    FString GroupClause;
+    {
+        DATAACCESS_SCOPE_PHASE(BuildSql);
+        FString GroupList = FString::Join(Groups, TEXT(","));
+        ColumnList = Groups.Num() > 0 ? FString::Printf(TEXT("%s,%s(%s)"), *GroupList, Function, *FieldName) : FString::Printf(TEXT("%s(%s)"), Function, *FieldName);
+        GroupClause = Groups.Num() > 0 ? "GROUP BY " + GroupList : FString();
+    }
+    
+    // OrderBy, Limit and Offset apply to the groups
+    FString OrderClause = GenerateOrderClause(false);
+    if(!OrderClause.IsEmpty())
+    {
+        GroupClause = GroupClause.IsEmpty() ? OrderClause : GroupClause + " " + OrderClause;
+    }
+    
+    sqlite3_stmt* SqliteStatement = AcquireStatement(ESqliteStatementType::Aggregate, GenerateWhereClause(), 0, GroupClause, ColumnList);
+    if(!SqliteStatement)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("%s: cannot prepare sqlite statement. Error message \"%s\""), Function, UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
+        ClearQuery();
+        return false;
+    }
+    
+    if(!BindSelectToStatement(SqliteStatement))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("%s: cannot bind where clause. Error message \"%s\""), Function, UTF8_TO_TCHAR(sqlite3_errmsg(GetReadDatabase())));
+        ReleaseStatement(SqliteStatement);
+        ClearQuery();
+        return false;
+    }
+    
+    int32 ResultCode;
+    while((ResultCode = SqliteStepTimed(SqliteStatement)) == SQLITE_ROW)
+    {
+        DATAACCESS_SCOPE_PHASE(Decode);
+        FDataAggregateGroup& Group = OutGroups[OutGroups.AddDefaulted()];
+        Group.Keys.Reserve(Groups.Num());
+        for(int32 i = 0; i < Groups.Num(); ++i)
+        {
+            Group.Keys.Add(SqliteDataHandlerHelpers::ReadColumnValue(SqliteStatement, i));
+        }
+        Group.Value = SqliteDataHandlerHelpers::ReadColumnValue(SqliteStatement, Groups.Num());
+        DATAACCESS_INC_COUNTER(RowsRead, 1);
+    }
+    
+    if(ResultCode != SQLITE_DONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("%s: error executing select statement. Error message \"%s\""), Function, UTF8_TO_TCHAR(sqlite3_errmsg(sqlite3_db_handle(SqliteStatement))));
+        ReleaseStatement(SqliteStatement);
+        ClearQuery();
+        OutGroups.Empty();
+        return false;
+    }
+    
+    ReleaseStatement(SqliteStatement);
+    ClearQuery();
+    return true;
+}
+
+bool SqliteDataHandler::AggregateValue(const TCHAR* Function, const FString& FieldName, FDataValue& OutValue)
+{
+    check(QueryStarted == true);
+    
+    OutValue = FDataValue();
+    if(GetGroupParts().Num() > 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("%s: grouped queries have one value per group, pass an array of groups"), Function);
+        ClearQuery();
+        return false;
+    }
+    
+    TArray<FDataAggregateGroup> Groups;
+    if(!Aggregate(Function, FieldName, Groups))
+    {
+        return false;
+    }
+    
+    // Aggregates without GROUP BY always return exactly one row
+    if(Groups.Num() > 0)
+    {
+        OutValue = Groups[0].Value;
+    }
+    return true;
+}
+
+bool SqliteDataHandler::AcquireWriteStatements(ESqliteStatementType::Type StatementType, const FString& WhereClause, sqlite3_stmt*& OutWriteStatement, sqlite3_stmt*& OutTimestampStatement, uint64 ColumnMask)
+{
+    check(StatementType == ESqliteStatementType::Insert || StatementType == ESqliteStatementType::Update);
+    
+    OutWriteStatement = nullptr;
+    OutTimestampStatement = nullptr;
+    
+    // With RETURNING the write reports the generated columns itself, otherwise a second select reads them back
+    bool bInsert = StatementType == ESqliteStatementType::Insert;
+    if(DataResource->SupportsReturning())
+    {
+        OutWriteStatement = AcquireStatement(bInsert ? ESqliteStatementType::InsertReturning : ESqliteStatementType::UpdateReturning, WhereClause, ColumnMask);
+        return OutWriteStatement != nullptr;
+    }
+    
+    OutWriteStatement = AcquireStatement(StatementType, WhereClause, ColumnMask);
+    if(!OutWriteStatement)
+    {
+        return false;
+    }
+    
+    OutTimestampStatement = AcquireStatement(bInsert ? ESqliteStatementType::InsertTimestamps : ESqliteStatementType::UpdateTimestamp, WhereClause);
+    if(!OutTimestampStatement)
+    {
+        ReleaseStatement(OutWriteStatement);
+        OutWriteStatement = nullptr;
+        return false;
+    }
+    
+    return true;
+}
+
+bool SqliteDataHandler::InsertObject(UObject* const Obj, sqlite3_stmt* const InsertStatement, sqlite3_stmt* const TimestampStatement)
+{
+    check(SourceSchema->CreateTimestampProperty && SourceSchema->LastUpdateTimestampProperty);
+    
+    // Every parameter is rebound below, text bound for the previous object of a batch can be overwritten
+    Scratch->Reset();
+    if(!BindObjectToStatement(Obj, InsertStatement))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Create: error binding sqlite statement."));
+        sqlite3_reset(InsertStatement);
+        return false;
+    }
+    
+    // Execute
+    int32 ResultCode = SqliteStepTimed(InsertStatement);
+    if(!TimestampStatement)
+    {
+        // RETURNING Id, CreateTimestamp, LastUpdateTimestamp
+        if(ResultCode != SQLITE_ROW)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("Create: error executing insert statement.. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+            sqlite3_reset(InsertStatement);
+            return false;
+        }
+        
+        SourceSchema->IdProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(InsertStatement, 0));
+        SourceSchema->CreateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(InsertStatement, 1));
+        SourceSchema->LastUpdateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(InsertStatement, 2));
+        
+        sqlite3_reset(InsertStatement);
+        DATAACCESS_INC_COUNTER(RowsWritten, 1);
+        return true;
+    }
+    
+    if(ResultCode != SQLITE_DONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Create: error executing insert statement.. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        sqlite3_reset(InsertStatement);
+        return false;
+    }
+    sqlite3_reset(InsertStatement);
+    DATAACCESS_INC_COUNTER(RowsWritten, 1);
+    
+    // Get last id, create, and update timestamps and update the UObject
+    int32 LastId = sqlite3_last_insert_rowid(DataResource->Get());
+    SourceSchema->IdProperty->SetPropertyValue_InContainer(Obj, LastId);
+    
+    if(sqlite3_bind_int(TimestampStatement, 1, LastId) != SQLITE_OK)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot bind class name to sqlite statement for seq. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        return false;
+    }
+    
+    if(SqliteStepTimed(TimestampStatement) != SQLITE_ROW)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Create: cannot step sqlite statement for seq. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        sqlite3_reset(TimestampStatement);
+        return false;
+    }
+    
+    SourceSchema->CreateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(TimestampStatement, 0));
+    SourceSchema->LastUpdateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(TimestampStatement, 1));
+    
+    sqlite3_reset(TimestampStatement);
+    return true;
+}
+
+bool SqliteDataHandler::UpdateObject(UObject* const Obj, sqlite3_stmt* const UpdateStatement, sqlite3_stmt* const TimestampStatement, bool bUseWhereClause, int32& OutUpdatedRows, uint64 ColumnMask)
+{
+    check(SourceSchema->LastUpdateTimestampProperty);
+    OutUpdatedRows = 0;
+    
+    // Every parameter is rebound below, text bound for the previous object of a batch can be overwritten
+    Scratch->Reset();
+    if(!BindObjectToStatement(Obj, UpdateStatement, ColumnMask))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Update: error binding sqlite statement."));
+        sqlite3_reset(UpdateStatement);
+        return false;
+    }
+    
+    // Bind Where Paramters, either the built where clause or the object's Id
+    int32 WhereParameterIndex = 1;
+    for(int32 i = 0; i < SourceSchema->WritableColumns.Num(); ++i)
+    {
+        if(ColumnMask == 0 || (ColumnMask & (1ull << i)))
         {
-            if(sqlite3_bind_int64(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind uint64. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            ++WhereParameterIndex;
         }
-        else if(CurrentParameter.Key->GetName() == UFloatProperty::StaticClass()->GetName())
+    }
+    int32 Id = SourceSchema->IdProperty->GetPropertyValue_InContainer(Obj);
+    bool bBound = bUseWhereClause ? BindWhereToStatement(UpdateStatement, WhereParameterIndex) : sqlite3_bind_int(UpdateStatement, WhereParameterIndex, Id) == SQLITE_OK;
+    if(!bBound)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Update: cannot bind where clause. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        sqlite3_reset(UpdateStatement);
+        return false;
+    }
+    
+    // Execute.  With RETURNING every updated row reports its LastUpdateTimestamp, the first one is kept.
+    int32 UpdatedRows = 0;
+    int32 ResultCode = SqliteStepTimed(UpdateStatement);
+    while(!TimestampStatement && ResultCode == SQLITE_ROW)
+    {
+        if(UpdatedRows == 0)
         {
-            if(sqlite3_bind_double(SqliteStatement, ParameterIndex, FCString::Atof(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind float. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            SourceSchema->LastUpdateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(UpdateStatement, 0));
         }
-        else if(CurrentParameter.Key->GetName() == UDoubleProperty::StaticClass()->GetName())
+        ++UpdatedRows;
+        ResultCode = SqliteStepTimed(UpdateStatement);
+    }
+    
+    if(ResultCode != SQLITE_DONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Update: error executing update statement.. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        sqlite3_reset(UpdateStatement);
+        return false;
+    }
+    sqlite3_reset(UpdateStatement);
+    
+    if(TimestampStatement)
+    {
+        UpdatedRows = sqlite3_changes(DataResource->Get());
+    }
+    
+    if(UpdatedRows == 0)
+    {
+        UE_LOG(LogDataAccess, Log, TEXT("Update: Nothing to update"));
+        return true;
+    }
+    OutUpdatedRows = UpdatedRows;
+    DATAACCESS_INC_COUNTER(RowsWritten, UpdatedRows);
+    
+    if(!TimestampStatement)
+    {
+        return true;
+    }
+    
+    // Get the update timestamp and update the UObject
+    bBound = bUseWhereClause ? BindWhereToStatement(TimestampStatement, 1) : sqlite3_bind_int(TimestampStatement, 1, Id) == SQLITE_OK;
+    if(!bBound)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Update: cannot bind where clause for timestamp. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        return false;
+    }
+    
+    if(SqliteStepTimed(TimestampStatement) != SQLITE_ROW)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Update: cannot step sqlite statement for timestamp. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+        sqlite3_reset(TimestampStatement);
+        return false;
+    }
+    
+    SourceSchema->LastUpdateTimestampProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(TimestampStatement, 0));
+    
+    sqlite3_reset(TimestampStatement);
+    return true;
+}
+
+bool SqliteDataHandler::GetWhereId(int32& OutId) const
+{
+    const TArray<FString>& Parts = GetQueryParts();
+    if(Parts.Num() != 3 || QueryParameters.Num() != 1 || Parts[0] != TEXT("Id") || Parts[1] != TEXT("=") || QueryParameters[0].GetType() != EDataValueType::Integer)
+    {
+        return false;
+    }
+    
+    if(KeysetValues.Num() > 0)
+    {
+        return false;
+    }
+    
+    OutId = QueryParameters[0].AsInt32();
+    return true;
+}
+
+bool SqliteDataHandler::GetChangedColumns(UObject* const Obj, uint64& OutColumnMask) const
+{
+    OutColumnMask = 0;
+    if(!DataResource->IsChangeTracking() || !DataResource->GetSnapshots().Diff(*SourceSchema, Obj, OutColumnMask))
+    {
+        return true;
+    }
+    
+    if(OutColumnMask == 0)
+    {
+        return false;
+    }
+    
+    // Everything changed, share the statement that sets every column
+    const int32 NumWritable = SourceSchema->WritableColumns.Num();
+    const uint64 AllColumns = NumWritable >= 64 ? MAX_uint64 : (1ull << NumWritable) - 1;
+    if(OutColumnMask == AllColumns)
+    {
+        OutColumnMask = 0;
+    }
+    return true;
+}
+
+void SqliteDataHandler::ForgetSnapshots()
+{
+    if(!DataResource->UsesSnapshots())
+    {
+        return;
+    }
+    
+    int32 WhereId;
+    if(GetWhereId(WhereId))
+    {
+        DataResource->GetSnapshots().Remove(SourceClass, WhereId);
+    }
+    else
+    {
+        DataResource->GetSnapshots().RemoveClass(SourceClass);
+    }
+}
+
+void SqliteDataHandler::AddSetPart(const FString& FieldName, const FString& Assignment, const FDataValue& Value)
+{
+    int32 ColumnIndex = SourceSchema->FindColumn(FieldName);
+    if(ColumnIndex == INDEX_NONE)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Set: FieldName \"%s\" does not exist in UClass \"%s\".  Assignment not added"), *(FieldName), *(SourceClass->GetName()));
+        return;
+    }
+    
+    const FSqliteColumn& Column = SourceSchema->Columns[ColumnIndex];
+    if(Column.bGenerated || !Column.SqlType || FCString::Strcmp(Column.SqlType, TEXT("BLOB")) == 0)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("Set: FieldName \"%s\" is written by the database or stored as an array.  Assignment not added"), *(FieldName));
+        return;
+    }
+    
+    SetParts.Add(Assignment);
+    SetParameters.Add(Value);
+}
+
+void SqliteDataHandler::StoreSnapshot(UObject* const Obj)
+{
+    if(DataResource->UsesSnapshots())
+    {
+        DataResource->GetSnapshots().Store(*SourceSchema, Obj);
+    }
+}
+
+bool SqliteDataHandler::ExecuteStatement(const TCHAR* Sql)
+{
+    char* ErrorMessage = nullptr;
+    int32 ByteCount;
+    if(sqlite3_exec(DataResource->Get(), Scratch->ToUtf8(Sql, FCString::Strlen(Sql), ByteCount), nullptr, nullptr, &ErrorMessage) != SQLITE_OK)
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("ExecuteStatement: \"%s\" failed. Error message \"%s\""), Sql, UTF8_TO_TCHAR(ErrorMessage));
+        sqlite3_free(ErrorMessage);
+        return false;
+    }
+    
+    return true;
+}
+
+FString SqliteDataHandler::GetSavepointName(int32 Depth) const
+{
+    return FString::Printf(TEXT("DataAccess%i_%i"), SavepointPrefix, Depth);
+}
+
+int32 SqliteDataHandler::BindValueToStatement(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FDataValue& Value, bool bTransient)
+{
+    switch(Value.GetType())
+    {
+    case EDataValueType::Integer:
+        return sqlite3_bind_int64(SqliteStatement, ParameterIndex, Value.AsInt64());
+    case EDataValueType::Real:
+        return sqlite3_bind_double(SqliteStatement, ParameterIndex, Value.AsDouble());
+    case EDataValueType::Text:
         {
-            if(sqlite3_bind_double(SqliteStatement, ParameterIndex, FCString::Atof(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind double. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            int32 ByteCount;
+            const ANSICHAR* Utf8 = Scratch->ToUtf8(Value.GetText(), ByteCount);
+            return sqlite3_bind_text(SqliteStatement, ParameterIndex, Utf8, ByteCount, bTransient ? SQLITE_TRANSIENT : SQLITE_STATIC);
         }
-        else if(CurrentParameter.Key->GetName() == UBoolProperty::StaticClass()->GetName())
+    default:
+        return sqlite3_bind_null(SqliteStatement, ParameterIndex);
+    }
+}
+
+bool SqliteDataHandler::BindWhereToStatement(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, bool bTransient)
+{
+    DATAACCESS_SCOPE_PHASE(Bind);
+    bool bSuccess = true;
+    // Binding index is 1 based not 0 based
+    for(const FDataValue& Parameter : QueryParameters)
+    {
+        if(BindValueToStatement(SqliteStatement, ParameterIndex, Parameter, bTransient) != SQLITE_OK)
         {
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, FCString::Atoi(*CurrentParameter.Value)) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind bool. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind parameter %i. Error message \"%s\""), ParameterIndex, UTF8_TO_TCHAR(sqlite3_errmsg(sqlite3_db_handle(SqliteStatement))));
+            bSuccess = false;
         }
-        else if(CurrentParameter.Key->GetName() == UStrProperty::StaticClass()->GetName())
+        ++ParameterIndex;
+    }
+    
+    // Keyset values in the order GenerateWhereClause uses them: the leading range, then every key but the last twice
+    const int32 NumKeys = KeysetValues.Num();
+    for(int32 i = NumKeys > 1 ? -1 : 0; i < NumKeys; ++i)
+    {
+        const FDataValue& Value = KeysetValues[FMath::Max(i, 0)];
+        int32 ResultCode = BindValueToStatement(SqliteStatement, ParameterIndex++, Value, bTransient);
+        if(ResultCode == SQLITE_OK && i >= 0 && i < NumKeys - 1)
         {
-            if(sqlite3_bind_text(SqliteStatement, ParameterIndex, TCHAR_TO_UTF8(*CurrentParameter.Value), FCString::Strlen(*CurrentParameter.Value), SQLITE_TRANSIENT) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind string. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            ResultCode = BindValueToStatement(SqliteStatement, ParameterIndex++, Value, bTransient);
         }
-        else
+        
+        if(ResultCode != SQLITE_OK)
         {
-            UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: Data type %s is not supported"), *(CurrentParameter.Key->GetName()));
+            UE_LOG(LogDataAccess, Error, TEXT("BindWhereToStatement: cannot bind keyset parameter %i. Error message \"%s\""), ParameterIndex - 1, UTF8_TO_TCHAR(sqlite3_errmsg(sqlite3_db_handle(SqliteStatement))));
             bSuccess = false;
         }
-        ++ParameterIndex;
     }
 
     return bSuccess;
 }
 
-bool SqliteDataHandler::BindObjectToStatement(UObject* const Obj, sqlite3_stmt* const SqliteStatement)
+bool SqliteDataHandler::BindSelectToStatement(sqlite3_stmt* const SqliteStatement, bool bTransient)
+{
+    if(!BindWhereToStatement(SqliteStatement, 1, bTransient))
+    {
+        return false;
+    }
+    
+    if(QueryLimit == INDEX_NONE && QueryOffset == 0)
+    {
+        return true;
+    }
+    
+    DATAACCESS_SCOPE_PHASE(Bind);
+    const int32 NumKeysetParameters = KeysetValues.Num() > 1 ? KeysetValues.Num() * 2 : KeysetValues.Num();
+    int32 ParameterIndex = 1 + QueryParameters.Num() + NumKeysetParameters;
+    if(sqlite3_bind_int64(SqliteStatement, ParameterIndex, QueryLimit) != SQLITE_OK ||
+       (QueryOffset > 0 && sqlite3_bind_int64(SqliteStatement, ParameterIndex + 1, QueryOffset) != SQLITE_OK))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("BindSelectToStatement: cannot bind limit. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(sqlite3_db_handle(SqliteStatement))));
+        return false;
+    }
+    
+    return true;
+}
+
+bool SqliteDataHandler::BindObjectToStatement(UObject* const Obj, sqlite3_stmt* const SqliteStatement, uint64 ColumnMask)
 {
+    DATAACCESS_SCOPE_PHASE(Bind);
     check(SqliteStatement);
     int32 ParameterIndex = 1;
     bool bSuccess = true;
     
-    // Iterate through all of the UObject properties and bind values to the passed in prepared statement.
-	// Since the query is built off the same query of the object.  The ordering should be the same.
-    for(TFieldIterator<UProperty> Itr(Obj->GetClass()); Itr; ++Itr)
+    // Bind the writable columns in the same order the schema built the statement with
+    for(int32 i = 0; i < SourceSchema->WritableColumns.Num(); ++i)
     {
-        UProperty* Property = *Itr;
-		if (Property->GetName() == "Id" || Property->GetName() == "CreateTimestamp" || Property->GetName() == "LastUpdateTimestamp" || !Property->HasMetaData("SaveToDatabase") || !Property->GetMetaData("SaveToDatabase").ToUpper().Equals("TRUE"))
+        if(ColumnMask != 0 && !(ColumnMask & (1ull << i)))
         {
             continue;
         }
         
-        if(Property->IsA(UByteProperty::StaticClass()))
-        {
-            UByteProperty* ByteProperty = CastChecked<UByteProperty>(Property);
-            uint8 CurrentValue = ByteProperty->GetPropertyValue(Property->ContainerPtrToValuePtr<uint8>(Obj));
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind byte. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UInt8Property::StaticClass()))
-        {
-            UInt8Property* Int8Property = CastChecked<UInt8Property>(Property);
-            int8 CurrentValue = Int8Property->GetPropertyValue(Property->ContainerPtrToValuePtr<uint8>(Obj));
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind int8. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UInt16Property::StaticClass()))
-        {
-            UInt16Property* Int16Property = CastChecked<UInt16Property>(Property);
-            int16 CurrentValue = Int16Property->GetPropertyValue(Property->ContainerPtrToValuePtr<int16>(Obj));
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind int16. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UIntProperty::StaticClass()))
-        {
-            UIntProperty* Int32Property = CastChecked<UIntProperty>(Property);
-            int32 CurrentValue = Int32Property->GetPropertyValue(Property->ContainerPtrToValuePtr<int32>(Obj));
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind int32. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UInt64Property::StaticClass()))
-        {
-            UInt64Property* Int64Property = CastChecked<UInt64Property>(Property);
-            int64 CurrentValue = Int64Property->GetPropertyValue(Property->ContainerPtrToValuePtr<int64>(Obj));
-            if(sqlite3_bind_int64(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind int64. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UUInt16Property::StaticClass()))
-        {
-            UUInt16Property* UInt16Property = CastChecked<UUInt16Property>(Property);
-            uint16 CurrentValue = UInt16Property->GetPropertyValue(Property->ContainerPtrToValuePtr<uint16>(Obj));
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind uint16. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UUInt32Property::StaticClass()))
-        {
-            UUInt32Property* UInt32Property = CastChecked<UUInt32Property>(Property);
-            uint32 CurrentValue = UInt32Property->GetPropertyValue(Property->ContainerPtrToValuePtr<uint32>(Obj));
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind uint32. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UUInt64Property::StaticClass()))
-        {
-            UUInt64Property* UInt64Property = CastChecked<UUInt64Property>(Property);
-            uint64 CurrentValue = UInt64Property->GetPropertyValue(Property->ContainerPtrToValuePtr<uint64>(Obj));
-            if(sqlite3_bind_int64(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind uint64. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UFloatProperty::StaticClass()))
-        {
-            UFloatProperty* FloatProperty = CastChecked<UFloatProperty>(Property);
-            float CurrentValue = FloatProperty->GetPropertyValue(Property->ContainerPtrToValuePtr<float>(Obj));
-            if(sqlite3_bind_double(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind float. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UDoubleProperty::StaticClass()))
-        {
-            UDoubleProperty* DoubleProperty = CastChecked<UDoubleProperty>(Property);
-            double CurrentValue = DoubleProperty->GetPropertyValue(Property->ContainerPtrToValuePtr<double>(Obj));
-            if(sqlite3_bind_double(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind double. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UBoolProperty::StaticClass()))
-        {
-            UBoolProperty* BoolProperty = CastChecked<UBoolProperty>(Property);
-            bool CurrentValue = BoolProperty->GetPropertyValue(Property->ContainerPtrToValuePtr<bool>(Obj));
-            if(sqlite3_bind_int(SqliteStatement, ParameterIndex, CurrentValue) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind bool. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
-        }
-        else if(Property->IsA(UStrProperty::StaticClass()))
+        const FSqliteColumn& Column = SourceSchema->Columns[SourceSchema->WritableColumns[i]];
+        if(!Column.Bind)
         {
-            UStrProperty* StrProperty = CastChecked<UStrProperty>(Property);
-            FString CurrentValue = StrProperty->GetPropertyValue(Property->ContainerPtrToValuePtr<FString>(Obj));
-            if(sqlite3_bind_text(SqliteStatement, ParameterIndex, TCHAR_TO_UTF8(*CurrentValue), FCString::Strlen(*CurrentValue), SQLITE_TRANSIENT) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind string. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            UE_LOG(LogDataAccess, Error, TEXT("BindParameters: Data type on UPROPERTY() %s is not supported"), *(Column.Name));
+            bSuccess = false;
         }
-        else if(Property->IsA(UArrayProperty::StaticClass()))
+        else if(Column.Bind(SqliteStatement, ParameterIndex, Column, Column.GetValuePtr(Obj), *Scratch) != SQLITE_OK)
         {
-            UArrayProperty* ArrayProperty = CastChecked<UArrayProperty>(Property);
-            FScriptArrayHelper_InContainer ArrayHelper(ArrayProperty, Obj);
-            if(sqlite3_bind_blob(SqliteStatement, ParameterIndex, ArrayHelper.GetRawPtr(), ArrayHelper.Num() * ArrayProperty->Inner->ElementSize, SQLITE_TRANSIENT) != SQLITE_OK)
-            {
-                UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind array. Error message \"%s\""), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
-                bSuccess = false;
-            }
+            UE_LOG(LogDataAccess, Error, TEXT("BindParameters: cannot bind %s. Error message \"%s\""), *(Column.Name), UTF8_TO_TCHAR(sqlite3_errmsg(DataResource->Get())));
+            bSuccess = false;
         }
         else
         {
-            UE_LOG(LogDataAccess, Error, TEXT("BindParameters: Data type on UPROPERTY() %s is not supported"), *(Property->GetName()));
-            bSuccess = false;
+            DATAACCESS_INC_COUNTER(BytesWritten, Column.GetValueSize(Column.GetValuePtr(Obj)));
         }
         ++ParameterIndex;
     }
@@ -954,118 +2115,12 @@ bool SqliteDataHandler::BindObjectToStatement(UObject* const Obj, sqlite3_stmt*
 bool SqliteDataHandler::BindStatementToObject(sqlite3_stmt* const SqliteStatement, UObject* const Obj)
 {
     check(SqliteStatement);
-
-    int32 ColumnIndex = 0;
-    bool bSuccess = true;
-    
-    // Iterator through all of the UObject properties and the passed in prepared statement to it
-	// Since the query is built off the same query of the object.  The ordering should be the same.
-    for(TFieldIterator<UProperty> Itr(Obj->GetClass()); Itr; ++Itr)
-    {
-		UProperty* Property = *Itr;
-
-		// All properties to save to the database require the SaveToDatabase attribute
-		if (!Property->HasMetaData("SaveToDatabase") || !Property->GetMetaData("SaveToDatabase").ToUpper().Equals("TRUE"))
-		{
-			continue;
-		}
-
-        if(Property->IsA(UByteProperty::StaticClass()))
-        {
-            UByteProperty* ByteProperty = CastChecked<UByteProperty>(Property);
-            ByteProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UInt8Property::StaticClass()))
-        {
-            UInt8Property* Int8Property = CastChecked<UInt8Property>(Property);
-            Int8Property->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UInt16Property::StaticClass()))
-        {
-            UInt16Property* Int16Property = CastChecked<UInt16Property>(Property);
-            Int16Property->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UIntProperty::StaticClass()))
-        {
-            UIntProperty* Int32Property = CastChecked<UIntProperty>(Property);
-            Int32Property->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UInt64Property::StaticClass()))
-        {
-            UInt64Property* Int64Property = CastChecked<UInt64Property>(Property);
-            Int64Property->SetPropertyValue_InContainer(Obj, sqlite3_column_int64(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UUInt16Property::StaticClass()))
-        {
-            UUInt16Property* UInt16Property = CastChecked<UUInt16Property>(Property);
-            UInt16Property->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UUInt32Property::StaticClass()))
-        {
-            UUInt32Property* UInt32Property = CastChecked<UUInt32Property>(Property);
-            UInt32Property->SetPropertyValue_InContainer(Obj, sqlite3_column_int(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UUInt64Property::StaticClass()))
-        {
-            UUInt64Property* UInt64Property = CastChecked<UUInt64Property>(Property);
-            UInt64Property->SetPropertyValue_InContainer(Obj, sqlite3_column_int64(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UFloatProperty::StaticClass()))
-        {
-            UFloatProperty* FloatProperty = CastChecked<UFloatProperty>(Property);
-            FloatProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_double(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UDoubleProperty::StaticClass()))
-        {
-            UDoubleProperty* DoubleProperty = CastChecked<UDoubleProperty>(Property);
-            DoubleProperty->SetPropertyValue_InContainer(Obj, sqlite3_column_double(SqliteStatement, ColumnIndex));
-        }
-        else if(Property->IsA(UBoolProperty::StaticClass()))
-        {
-            UBoolProperty* BoolProperty = CastChecked<UBoolProperty>(Property);
-            BoolProperty->SetPropertyValue_InContainer(Obj, (sqlite3_column_int(SqliteStatement, ColumnIndex) == 0 ? false : true));
-        }
-        else if(Property->IsA(UStrProperty::StaticClass()))
-        {
-            UStrProperty* StrProperty = CastChecked<UStrProperty>(Property);
-            StrProperty->SetPropertyValue_InContainer(Obj, UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, ColumnIndex)));
-        }
-        else if(Property->IsA(UArrayProperty::StaticClass()))
-        {
-            UArrayProperty* ArrayProperty = CastChecked<UArrayProperty>(Property);
-            const uint8* SrcRaw = static_cast<const uint8*>(sqlite3_column_blob(SqliteStatement, ColumnIndex));
-            int32 SrcCount = sqlite3_column_bytes(SqliteStatement, ColumnIndex);
-
-            // Copy values internal is really looking for two void* pointers to TArrays.  Therefore, here we should make a TArray<uint8> of the data from sqlite.
-            TArray<uint8> Src;
-            Src.AddUninitialized(SrcCount);
-            
-            for(int32 i = 0; i < SrcCount; ++i)
-            {
-                Src[i] = SrcRaw[i];
-            }
-            
-            void* Dest = ArrayProperty->ContainerPtrToValuePtr<void>(Obj);
-            
-            ArrayProperty->CopyValuesInternal(Dest, static_cast<void*>(&Src), 1);
-            
-            // We need to resize the array to represent the element size and not the byte size
-            FScriptArrayHelper_InContainer ArrayHelper(ArrayProperty, Obj);
-            ArrayHelper.Resize( SrcCount / ArrayProperty->Inner->ElementSize );
-        }
-        else
-        {
-            UE_LOG(LogDataAccess, Error, TEXT("BindParameters: Data type on UPROPERTY() %s is not supported"), *(Property->GetName()));
-            bSuccess = false;
-        }
-        ++ColumnIndex;
-    }
-    
-    return bSuccess;
+    return SourceSchema->ReadRow(SqliteStatement, Obj, SelectMask);
 }
 
 bool SqliteDataHandler::BindStatementToArray(sqlite3_stmt* const SqliteStatement, TSharedPtr< FJsonValue >& JsonValue)
 {
+    DATAACCESS_SCOPE_PHASE(Decode);
 	check(SqliteStatement)
 
 	int32 ColumnCount = sqlite3_column_count(SqliteStatement);
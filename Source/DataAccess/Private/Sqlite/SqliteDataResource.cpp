@@ -2,8 +2,15 @@
 #include "DataAccessPrivatePCH.h"
 #include "SqliteDataResource.h"
 
-SqliteDataResource::SqliteDataResource(FString DatabaseFileLocation)
+SqliteDataResource::SqliteDataResource(FString DatabaseFileLocation, int32 StatementCacheCapacity, int32 ReaderCount)
 : DatabaseFileLocation(DatabaseFileLocation)
+, DatabaseResource(nullptr)
+, StatementCache(StatementCacheCapacity)
+, bChangeTracking(false)
+, bIdentityMap(false)
+, StatementCacheCapacity(StatementCacheCapacity)
+, ReaderCount(FMath::Max(ReaderCount, 0))
+, NextReader(0)
 {}
 
 SqliteDataResource::~SqliteDataResource()
@@ -24,9 +31,23 @@ bool SqliteDataResource::Acquire()
     {
         UE_LOG(LogDataAccess, Error, TEXT("Acquire: Cannot open a database connection with %s with error %s"), *DatabaseFileLocation, UTF8_TO_TCHAR(sqlite3_errmsg(DatabaseResource)));
         sqlite3_close(DatabaseResource);
+        DatabaseResource = nullptr;
         return false;
     }
     
+    if(!ConnectionProfile.Apply(DatabaseResource))
+    {
+        UE_LOG(LogDataAccess, Warning, TEXT("Acquire: connection profile not fully applied to %s"), *DatabaseFileLocation);
+    }
+    
+    if(ReaderCount > 0 && !AcquireReaders())
+    {
+        Release();
+        return false;
+    }
+    
+    EffectiveSettings.Read(DatabaseResource);
+    UE_LOG(LogDataAccess, Log, TEXT("Acquire: %s opened with %s"), *DatabaseFileLocation, *EffectiveSettings.ToString());
     return true;
 }
 
@@ -37,7 +58,32 @@ bool SqliteDataResource::Release()
         return true;
     }
     
-    if(sqlite3_close(DatabaseResource) != SQLITE_OK)
+    if(QueryPlanAdvisor.IsEnabled())
+    {
+        QueryPlanAdvisor.LogReport();
+    }
+    
+    // Cursors on other threads may be returning statements meanwhile, they look the connections up under the same lock
+    FScopeLock ScopeLock(&ReaderLock);
+    
+    // Cached statements keep the connection busy, they have to go first.  Statements still checked out, e.g. by
+    // cursors outliving the release, keep their connection open until they are returned.
+    for(FSqliteReaderConnection& Reader : Readers)
+    {
+        Reader.StatementCache.Flush();
+        if(sqlite3_close_v2(Reader.Database) != SQLITE_OK)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("Release: Cannot close a reader connection with %s with error %s"), *DatabaseFileLocation, UTF8_TO_TCHAR(sqlite3_errmsg(Reader.Database)));
+        }
+    }
+    Readers.Empty();
+    ReaderAssignments.Empty();
+    NextReader = 0;
+    
+    StatementCache.Flush();
+    Snapshots.Empty();
+    
+    if(sqlite3_close_v2(DatabaseResource) != SQLITE_OK)
     {
         UE_LOG(LogDataAccess, Error, TEXT("Release: Cannot close a database connection with %s with error %s"), *DatabaseFileLocation, UTF8_TO_TCHAR(sqlite3_errmsg(DatabaseResource)));
     }
@@ -49,3 +95,193 @@ sqlite3* SqliteDataResource::Get() const
 {
     return DatabaseResource;
 }
+
+SqliteStatementCache& SqliteDataResource::GetStatementCache()
+{
+    return StatementCache;
+}
+
+void SqliteDataResource::SetConnectionProfile(const FSqliteConnectionProfile& Profile)
+{
+    ConnectionProfile = Profile;
+}
+
+bool SqliteDataResource::SetConnectionProfile(FName ProfileName)
+{
+    if(!FSqliteConnectionProfile::Find(ProfileName, ConnectionProfile))
+    {
+        UE_LOG(LogDataAccess, Error, TEXT("SetConnectionProfile: no connection profile named %s"), *ProfileName.ToString());
+        return false;
+    }
+    return true;
+}
+
+const FSqliteConnectionSettings& SqliteDataResource::GetEffectiveSettings() const
+{
+    return EffectiveSettings;
+}
+
+SqliteStatementCache& SqliteDataResource::GetStatementCache(sqlite3* Connection)
+{
+    FScopeLock ScopeLock(&ReaderLock);
+    for(FSqliteReaderConnection& Reader : Readers)
+    {
+        if(Reader.Database == Connection)
+        {
+            return Reader.StatementCache;
+        }
+    }
+    
+    check(Connection == DatabaseResource);
+    return StatementCache;
+}
+
+void SqliteDataResource::ReturnStatement(sqlite3_stmt* SqliteStatement)
+{
+    if(!SqliteStatement)
+    {
+        return;
+    }
+    
+    // Held while returning too, so Release cannot free the reader's cache in between
+    FScopeLock ScopeLock(&ReaderLock);
+    sqlite3* Connection = sqlite3_db_handle(SqliteStatement);
+    if(Connection == DatabaseResource)
+    {
+        StatementCache.Return(SqliteStatement);
+        return;
+    }
+    
+    for(FSqliteReaderConnection& Reader : Readers)
+    {
+        if(Reader.Database == Connection)
+        {
+            Reader.StatementCache.Return(SqliteStatement);
+            return;
+        }
+    }
+    
+    // The connection was released while the statement was checked out and closes once it is finalized
+    sqlite3_finalize(SqliteStatement);
+}
+
+FSqliteReaderConnection* SqliteDataResource::GetReader()
+{
+    const uint32 ThreadId = FPlatformTLS::GetCurrentThreadId();
+    
+    FScopeLock ScopeLock(&ReaderLock);
+    if(Readers.Num() == 0)
+    {
+        return nullptr;
+    }
+    
+    const int32* Assigned = ReaderAssignments.Find(ThreadId);
+    if(Assigned)
+    {
+        return &Readers[*Assigned];
+    }
+    
+    // More threads than readers share connections, sqlite serializes them
+    int32 ReaderIndex = NextReader;
+    NextReader = (NextReader + 1) % Readers.Num();
+    ReaderAssignments.Add(ThreadId, ReaderIndex);
+    return &Readers[ReaderIndex];
+}
+
+int32 SqliteDataResource::GetReaderCount() const
+{
+    return Readers.Num();
+}
+
+bool SqliteDataResource::AcquireReaders()
+{
+    // journal_mode reports the mode it ended up in, memory and temporary databases stay out of WAL
+    sqlite3_stmt* SqliteStatement = nullptr;
+    FString JournalMode;
+    if(sqlite3_prepare_v2(DatabaseResource, "PRAGMA journal_mode=WAL;", -1, &SqliteStatement, nullptr) == SQLITE_OK && sqlite3_step(SqliteStatement) == SQLITE_ROW)
+    {
+        JournalMode = UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, 0));
+    }
+    sqlite3_finalize(SqliteStatement);
+    
+    if(!JournalMode.Equals("wal", ESearchCase::IgnoreCase))
+    {
+        UE_LOG(LogDataAccess, Warning, TEXT("Acquire: %s cannot use WAL mode (journal mode is \"%s\"), reads go through the writer"), *DatabaseFileLocation, *JournalMode);
+        return true;
+    }
+    
+    // Readers only wait on the writer while it checkpoints
+    sqlite3_busy_timeout(DatabaseResource, 5000);
+    
+    // The journal and sync mode belong to the writer, only the per-connection caches apply to readers
+    FSqliteConnectionProfile ReaderProfile = ConnectionProfile;
+    ReaderProfile.JournalMode.Empty();
+    ReaderProfile.Synchronous.Empty();
+    ReaderProfile.PageSize = 0;
+    
+    for(int32 i = 0; i < ReaderCount; ++i)
+    {
+        FSqliteReaderConnection* Reader = new FSqliteReaderConnection(StatementCacheCapacity);
+        if(sqlite3_open_v2(TCHAR_TO_UTF8(*DatabaseFileLocation), &Reader->Database, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+        {
+            UE_LOG(LogDataAccess, Error, TEXT("Acquire: Cannot open a reader connection with %s with error %s"), *DatabaseFileLocation, UTF8_TO_TCHAR(sqlite3_errmsg(Reader->Database)));
+            sqlite3_close(Reader->Database);
+            delete Reader;
+            return false;
+        }
+        
+        sqlite3_busy_timeout(Reader->Database, 5000);
+        ReaderProfile.Apply(Reader->Database);
+        Readers.Add(Reader);
+    }
+    
+    return true;
+}
+
+void SqliteDataResource::SetChangeTracking(bool bEnabled)
+{
+    bChangeTracking = bEnabled;
+    if(!UsesSnapshots())
+    {
+        Snapshots.Empty();
+    }
+}
+
+bool SqliteDataResource::IsChangeTracking() const
+{
+    return bChangeTracking;
+}
+
+void SqliteDataResource::SetIdentityMap(bool bEnabled)
+{
+    bIdentityMap = bEnabled;
+    if(!UsesSnapshots())
+    {
+        Snapshots.Empty();
+    }
+}
+
+bool SqliteDataResource::IsIdentityMap() const
+{
+    return bIdentityMap;
+}
+
+bool SqliteDataResource::UsesSnapshots() const
+{
+    return bChangeTracking || bIdentityMap;
+}
+
+SqliteSnapshotStore& SqliteDataResource::GetSnapshots()
+{
+    return Snapshots;
+}
+
+SqliteQueryPlanAdvisor& SqliteDataResource::GetQueryPlanAdvisor()
+{
+    return QueryPlanAdvisor;
+}
+
+bool SqliteDataResource::SupportsReturning() const
+{
+    return sqlite3_libversion_number() >= 3035000;
+}
@@ -0,0 +1,221 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteQueryPlanAdvisor.h"
+
+SqliteQueryPlanAdvisor::SqliteQueryPlanAdvisor()
+: bEnabled(false)
+, LargeTableRows(10000)
+{}
+
+void SqliteQueryPlanAdvisor::SetEnabled(bool bNewEnabled)
+{
+    bEnabled = bNewEnabled;
+}
+
+void SqliteQueryPlanAdvisor::SetLargeTableRows(int64 Rows)
+{
+    FScopeLock ScopeLock(&Lock);
+    LargeTableRows = Rows;
+}
+
+bool SqliteQueryPlanAdvisor::Observe(const FString& TableName, const FString& WhereClause)
+{
+    FString ShapeKey = TableName + TEXT(" ") + WhereClause;
+
+    FScopeLock ScopeLock(&Lock);
+    FShape* Shape = Shapes.Find(ShapeKey);
+    if(Shape)
+    {
+        ++Shape->Uses;
+        return false;
+    }
+
+    FShape NewShape;
+    NewShape.TableName = TableName;
+    NewShape.WhereClause = WhereClause;
+    NewShape.Uses = 1;
+    NewShape.bFullScan = false;
+    NewShape.TableRows = 0;
+    Shapes.Add(ShapeKey, NewShape);
+    return true;
+}
+
+void SqliteQueryPlanAdvisor::Explain(sqlite3* Database, const FString& TableName, const FString& WhereClause, const FString& Sql)
+{
+    check(Database);
+
+    TArray<FString> Plan;
+    bool bFullScan = false;
+
+    sqlite3_stmt* SqliteStatement = nullptr;
+    FString ExplainSql = TEXT("EXPLAIN QUERY PLAN ") + Sql;
+    if(sqlite3_prepare_v2(Database, TCHAR_TO_UTF8(*ExplainSql), -1, &SqliteStatement, nullptr) != SQLITE_OK)
+    {
+        UE_LOG(LogDataAccess, Warning, TEXT("Explain: cannot explain \"%s\". Error message \"%s\""), *Sql, UTF8_TO_TCHAR(sqlite3_errmsg(Database)));
+        sqlite3_finalize(SqliteStatement);
+        return;
+    }
+
+    // The detail is the last column: "SCAN TestObject", "SEARCH TestObject USING INDEX ..." and so on
+    const int32 DetailColumn = sqlite3_column_count(SqliteStatement) - 1;
+    while(sqlite3_step(SqliteStatement) == SQLITE_ROW)
+    {
+        FString Detail = UTF8_TO_TCHAR(sqlite3_column_text(SqliteStatement, DetailColumn));
+        if(Detail.StartsWith(TEXT("SCAN")) && !Detail.Contains(TEXT("COVERING INDEX")))
+        {
+            bFullScan = true;
+        }
+        Plan.Add(Detail);
+    }
+    sqlite3_finalize(SqliteStatement);
+
+    int64 TableRows = 0;
+    {
+        FScopeLock ScopeLock(&Lock);
+        const int64* Found = TableRowCounts.Find(TableName);
+        TableRows = Found ? *Found : -1;
+    }
+
+    // Counted once per table per session, good enough to tell small tables from large ones
+    if(bFullScan && TableRows < 0)
+    {
+        TableRows = 0;
+        FString CountSql = FString::Printf(TEXT("SELECT COUNT(*) FROM %s;"), *TableName);
+        if(sqlite3_prepare_v2(Database, TCHAR_TO_UTF8(*CountSql), -1, &SqliteStatement, nullptr) == SQLITE_OK && sqlite3_step(SqliteStatement) == SQLITE_ROW)
+        {
+            TableRows = sqlite3_column_int64(SqliteStatement, 0);
+        }
+        sqlite3_finalize(SqliteStatement);
+
+        FScopeLock ScopeLock(&Lock);
+        TableRowCounts.Add(TableName, TableRows);
+    }
+
+    FScopeLock ScopeLock(&Lock);
+    FShape* Shape = Shapes.Find(TableName + TEXT(" ") + WhereClause);
+    if(!Shape)
+    {
+        return;
+    }
+
+    Shape->Plan = Plan;
+    Shape->bFullScan = bFullScan && TableRows >= LargeTableRows;
+    Shape->TableRows = FMath::Max<int64>(TableRows, 0);
+    if(Shape->bFullScan)
+    {
+        Shape->RecommendedIndex = RecommendIndex(TableName, WhereClause);
+        UE_LOG(LogDataAccess, Warning, TEXT("Explain: full scan of %s (%lld rows) for \"%s\".  Recommended: %s"), *TableName, TableRows, *WhereClause, *(Shape->RecommendedIndex));
+    }
+}
+
+void SqliteQueryPlanAdvisor::GetShapes(TArray<FShape>& OutShapes) const
+{
+    FScopeLock ScopeLock(&Lock);
+    Shapes.GenerateValueArray(OutShapes);
+    OutShapes.Sort([](const FShape& A, const FShape& B) { return A.Uses > B.Uses; });
+}
+
+void SqliteQueryPlanAdvisor::GetRecommendations(TArray<FString>& OutStatements) const
+{
+    OutStatements.Empty();
+
+    FScopeLock ScopeLock(&Lock);
+    for(auto Itr = Shapes.CreateConstIterator(); Itr; ++Itr)
+    {
+        TArray<FString> Statements;
+        Itr.Value().RecommendedIndex.ParseIntoArray(&Statements, TEXT("\n"), true);
+        for(const FString& Statement : Statements)
+        {
+            OutStatements.AddUnique(Statement);
+        }
+    }
+}
+
+void SqliteQueryPlanAdvisor::LogReport() const
+{
+    TArray<FShape> SortedShapes;
+    GetShapes(SortedShapes);
+
+    UE_LOG(LogDataAccess, Log, TEXT("Query plan report: %i shapes"), SortedShapes.Num());
+    for(const FShape& Shape : SortedShapes)
+    {
+        UE_LOG(LogDataAccess, Log, TEXT("  %s %s: %llu uses, %s"), *(Shape.TableName), *(Shape.WhereClause), Shape.Uses, *FString::Join(Shape.Plan, TEXT("; ")));
+        if(Shape.bFullScan)
+        {
+            UE_LOG(LogDataAccess, Log, TEXT("    full scan of %lld rows, recommended: %s"), Shape.TableRows, *(Shape.RecommendedIndex.Replace(TEXT("\n"), TEXT(" "))));
+        }
+    }
+}
+
+void SqliteQueryPlanAdvisor::Reset()
+{
+    FScopeLock ScopeLock(&Lock);
+    Shapes.Empty();
+    TableRowCounts.Empty();
+}
+
+FString SqliteQueryPlanAdvisor::RecommendIndex(const FString& TableName, const FString& WhereClause)
+{
+    TArray<FString> Tokens;
+    WhereClause.ParseIntoArray(&Tokens, TEXT(" "), true);
+
+    TArray<FString> EqualityColumns;
+    TArray<FString> RangeColumns;
+    bool bDisjunction = false;
+    for(int32 i = 0; i + 1 < Tokens.Num(); ++i)
+    {
+        const FString& Operator = Tokens[i + 1];
+        if(Operator == TEXT("="))
+        {
+            EqualityColumns.AddUnique(Tokens[i]);
+        }
+        else if(Operator == TEXT("<") || Operator == TEXT(">") || Operator == TEXT("<=") || Operator == TEXT(">=") || Operator == TEXT("<>"))
+        {
+            RangeColumns.AddUnique(Tokens[i]);
+        }
+        bDisjunction |= Tokens[i] == TEXT("OR");
+    }
+
+    TArray<TArray<FString>> IndexColumns;
+    if(bDisjunction)
+    {
+        // An OR can only use indexes when every branch has one of its own
+        for(const FString& Column : EqualityColumns)
+        {
+            IndexColumns.AddDefaulted();
+            IndexColumns.Last().Add(Column);
+        }
+        for(const FString& Column : RangeColumns)
+        {
+            if(!EqualityColumns.Contains(Column))
+            {
+                IndexColumns.AddDefaulted();
+                IndexColumns.Last().Add(Column);
+            }
+        }
+    }
+    else
+    {
+        IndexColumns.AddDefaulted();
+        IndexColumns.Last() = EqualityColumns;
+        for(const FString& Column : RangeColumns)
+        {
+            if(!EqualityColumns.Contains(Column))
+            {
+                IndexColumns.Last().Add(Column);
+                break;
+            }
+        }
+    }
+
+    FString Recommendation;
+    for(const TArray<FString>& Columns : IndexColumns)
+    {
+        if(Columns.Num() > 0)
+        {
+            Recommendation += FString::Printf(TEXT("CREATE INDEX IF NOT EXISTS %s_%s_Index ON %s (%s);\n"), *TableName, *FString::Join(Columns, TEXT("_")), *TableName, *FString::Join(Columns, TEXT(",")));
+        }
+    }
+    Recommendation.RemoveFromEnd(TEXT("\n"));
+    return Recommendation;
+}
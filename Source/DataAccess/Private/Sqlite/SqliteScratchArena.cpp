@@ -0,0 +1,70 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteScratchArena.h"
+
+FSqliteScratchArena::FSqliteScratchArena(int32 ChunkSize)
+: ChunkSize(FMath::Max(ChunkSize, 64))
+, CurrentChunk(0)
+, CurrentOffset(0)
+{}
+
+FSqliteScratchArena::~FSqliteScratchArena()
+{
+    for(FChunk& Chunk : Chunks)
+    {
+        FMemory::Free(Chunk.Memory);
+    }
+}
+
+const ANSICHAR* FSqliteScratchArena::ToUtf8(const TCHAR* Source, int32 SourceLength, int32& OutByteCount)
+{
+    OutByteCount = SourceLength > 0 ? FTCHARToUTF8_Convert::ConvertedLength(Source, SourceLength) : 0;
+
+    ANSICHAR* Dest = static_cast<ANSICHAR*>(Allocate(OutByteCount + 1));
+    if(OutByteCount > 0)
+    {
+        FTCHARToUTF8_Convert::Convert(Dest, OutByteCount, Source, SourceLength);
+    }
+    Dest[OutByteCount] = '\0';
+    return Dest;
+}
+
+void FSqliteScratchArena::Reset()
+{
+    CurrentChunk = 0;
+    CurrentOffset = 0;
+}
+
+void* FSqliteScratchArena::Allocate(int32 Size)
+{
+    while(CurrentChunk < Chunks.Num())
+    {
+        FChunk& Chunk = Chunks[CurrentChunk];
+        if(CurrentOffset + Size <= Chunk.Size)
+        {
+            void* Result = Chunk.Memory + CurrentOffset;
+            CurrentOffset += Size;
+            return Result;
+        }
+
+        // A chunk that is too small even when empty is replaced instead of skipped forever
+        if(CurrentOffset == 0)
+        {
+            FMemory::Free(Chunk.Memory);
+            Chunk.Size = FMath::Max(ChunkSize, Size);
+            Chunk.Memory = static_cast<uint8*>(FMemory::Malloc(Chunk.Size));
+            continue;
+        }
+
+        ++CurrentChunk;
+        CurrentOffset = 0;
+    }
+
+    FChunk NewChunk;
+    NewChunk.Size = FMath::Max(ChunkSize, Size);
+    NewChunk.Memory = static_cast<uint8*>(FMemory::Malloc(NewChunk.Size));
+    Chunks.Add(NewChunk);
+    CurrentChunk = Chunks.Num() - 1;
+    CurrentOffset = Size;
+    return NewChunk.Memory;
+}
@@ -0,0 +1,54 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+/**
+ * Chunked bump allocator for the UTF-8 text a handler binds and prepares.  Memory handed out stays valid and in place
+ * until Reset, so statements can bind it with SQLITE_STATIC.  Reset keeps the chunks, after warming up binding strings
+ * does not allocate.
+ */
+class FSqliteScratchArena
+{
+public:
+    /**
+     * @param   ChunkSize   bytes per chunk, larger requests get a chunk of their own size
+     */
+    FSqliteScratchArena(int32 ChunkSize = 4096);
+    ~FSqliteScratchArena();
+
+    /**
+     * Convert a string to null terminated UTF-8 in the arena
+     *
+     * @param   Source          string to convert
+     * @param   SourceLength    number of characters to convert
+     * @param   OutByteCount    UTF-8 length in bytes, without the terminator
+     * @return                  converted string, valid until Reset
+     */
+    const ANSICHAR* ToUtf8(const TCHAR* Source, int32 SourceLength, int32& OutByteCount);
+
+    FORCEINLINE const ANSICHAR* ToUtf8(const FString& Source, int32& OutByteCount)
+    {
+        return ToUtf8(*Source, Source.Len(), OutByteCount);
+    }
+
+    /**
+     * Make every chunk available again.  Nothing handed out before may still be bound.
+     */
+    void Reset();
+
+private:
+    FSqliteScratchArena(const FSqliteScratchArena&);
+    FSqliteScratchArena& operator=(const FSqliteScratchArena&);
+
+    void* Allocate(int32 Size);
+
+    struct FChunk
+    {
+        uint8* Memory;
+        int32 Size;
+    };
+
+    TArray<FChunk> Chunks;
+    int32 ChunkSize;
+    int32 CurrentChunk;
+    int32 CurrentOffset;
+};
@@ -0,0 +1,229 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteClassSchema.h"
+#include "SqliteSnapshotStore.h"
+
+SqliteSnapshotStore::FSnapshot::FSnapshot(const FSnapshotKey& Key, const FSqliteClassSchemaRef& Schema)
+: Key(Key)
+, Schema(Schema)
+, Prev(nullptr)
+, Next(nullptr)
+{
+    // Only the persisted column values are ever touched, the rest of the class layout stays zeroed
+    Values = static_cast<uint8*>(FMemory::Malloc(Schema->Class->GetPropertiesSize(), Schema->Class->GetMinAlignment()));
+    FMemory::Memzero(Values, Schema->Class->GetPropertiesSize());
+
+    for(const FSqliteColumn& Column : Schema->Columns)
+    {
+        if(Column.Destroy)
+        {
+            Column.Property->InitializeValue(Column.GetValuePtr(Values));
+        }
+    }
+}
+
+SqliteSnapshotStore::FSnapshot::~FSnapshot()
+{
+    // The class and its properties may be gone by now, the schema's destroy functions do not need them
+    for(const FSqliteColumn& Column : Schema->Columns)
+    {
+        if(Column.Destroy)
+        {
+            Column.Destroy(Column.GetValuePtr(Values));
+        }
+    }
+    FMemory::Free(Values);
+}
+
+SqliteSnapshotStore::SqliteSnapshotStore(int32 Capacity)
+: Capacity(FMath::Max(Capacity, 0))
+, Head(nullptr)
+, Tail(nullptr)
+{}
+
+SqliteSnapshotStore::~SqliteSnapshotStore()
+{
+    Empty();
+}
+
+void SqliteSnapshotStore::Store(const FSqliteClassSchema& Schema, const void* Container)
+{
+    check(Container);
+
+    FSnapshotKey Key(Schema.Class, Schema.IdProperty->GetPropertyValue_InContainer(Container));
+
+    FScopeLock ScopeLock(&Lock);
+    FSnapshot** Found = Snapshots.Find(Key);
+    FSnapshot* Snapshot = Found ? *Found : nullptr;
+    if(Snapshot)
+    {
+        Touch(Snapshot);
+    }
+    else
+    {
+        Snapshot = new FSnapshot(Key, FSqliteClassSchema::Get(Schema.Class));
+        Snapshots.Add(Key, Snapshot);
+        Link(Snapshot);
+    }
+
+    for(const FSqliteColumn& Column : Schema.Columns)
+    {
+        if(Column.Destroy)
+        {
+            Column.Property->CopyCompleteValue(Column.GetValuePtr(Snapshot->Values), Column.GetValuePtr(Container));
+        }
+    }
+
+    Trim();
+}
+
+bool SqliteSnapshotStore::Load(const FSqliteClassSchema& Schema, int32 Id, void* Container)
+{
+    check(Container);
+
+    FScopeLock ScopeLock(&Lock);
+    FSnapshot** Found = Snapshots.Find(FSnapshotKey(Schema.Class, Id));
+    if(!Found)
+    {
+        return false;
+    }
+
+    FSnapshot* Snapshot = *Found;
+    Touch(Snapshot);
+    for(const FSqliteColumn& Column : Schema.Columns)
+    {
+        if(Column.Destroy)
+        {
+            Column.Property->CopyCompleteValue(Column.GetValuePtr(Container), Column.GetValuePtr(Snapshot->Values));
+        }
+    }
+    return true;
+}
+
+bool SqliteSnapshotStore::Diff(const FSqliteClassSchema& Schema, const void* Container, uint64& OutChangedMask)
+{
+    check(Container);
+
+    OutChangedMask = 0;
+    if(Schema.WritableColumns.Num() > 64)
+    {
+        return false;
+    }
+
+    FSnapshotKey Key(Schema.Class, Schema.IdProperty->GetPropertyValue_InContainer(Container));
+
+    FScopeLock ScopeLock(&Lock);
+    FSnapshot** Found = Snapshots.Find(Key);
+    if(!Found)
+    {
+        return false;
+    }
+
+    FSnapshot* Snapshot = *Found;
+    Touch(Snapshot);
+    for(int32 i = 0; i < Schema.WritableColumns.Num(); ++i)
+    {
+        const FSqliteColumn& Column = Schema.Columns[Schema.WritableColumns[i]];
+        if(Column.Destroy && !Column.Property->Identical(Column.GetValuePtr(Snapshot->Values), Column.GetValuePtr(Container)))
+        {
+            OutChangedMask |= 1ull << i;
+        }
+    }
+
+    return true;
+}
+
+void SqliteSnapshotStore::Remove(const UClass* Class, int32 Id)
+{
+    FScopeLock ScopeLock(&Lock);
+    FSnapshot** Found = Snapshots.Find(FSnapshotKey(Class, Id));
+    if(Found)
+    {
+        Free(*Found);
+    }
+}
+
+void SqliteSnapshotStore::RemoveClass(const UClass* Class)
+{
+    FScopeLock ScopeLock(&Lock);
+    FSnapshot* Snapshot = Head;
+    while(Snapshot)
+    {
+        FSnapshot* Next = Snapshot->Next;
+        if(Snapshot->Key.Class.Get() == Class)
+        {
+            Free(Snapshot);
+        }
+        Snapshot = Next;
+    }
+}
+
+void SqliteSnapshotStore::Empty()
+{
+    FScopeLock ScopeLock(&Lock);
+    while(Head)
+    {
+        Free(Head);
+    }
+    Snapshots.Empty();
+}
+
+void SqliteSnapshotStore::SetCapacity(int32 NewCapacity)
+{
+    FScopeLock ScopeLock(&Lock);
+    Capacity = FMath::Max(NewCapacity, 0);
+    Trim();
+}
+
+int32 SqliteSnapshotStore::Num() const
+{
+    FScopeLock ScopeLock(&Lock);
+    return Snapshots.Num();
+}
+
+void SqliteSnapshotStore::Link(FSnapshot* Snapshot)
+{
+    Snapshot->Prev = nullptr;
+    Snapshot->Next = Head;
+    if(Head)
+    {
+        Head->Prev = Snapshot;
+    }
+    Head = Snapshot;
+    if(!Tail)
+    {
+        Tail = Snapshot;
+    }
+}
+
+void SqliteSnapshotStore::Unlink(FSnapshot* Snapshot)
+{
+    (Snapshot->Prev ? Snapshot->Prev->Next : Head) = Snapshot->Next;
+    (Snapshot->Next ? Snapshot->Next->Prev : Tail) = Snapshot->Prev;
+    Snapshot->Prev = nullptr;
+    Snapshot->Next = nullptr;
+}
+
+void SqliteSnapshotStore::Touch(FSnapshot* Snapshot)
+{
+    if(Snapshot != Head)
+    {
+        Unlink(Snapshot);
+        Link(Snapshot);
+    }
+}
+
+void SqliteSnapshotStore::Free(FSnapshot* Snapshot)
+{
+    Unlink(Snapshot);
+    Snapshots.Remove(Snapshot->Key);
+    delete Snapshot;
+}
+
+void SqliteSnapshotStore::Trim()
+{
+    while(Capacity > 0 && Snapshots.Num() > Capacity)
+    {
+        Free(Tail);
+    }
+}
@@ -0,0 +1,130 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "SqliteStatementCache.h"
+#include "DataAccessStats.h"
+
+SqliteStatementCache::SqliteStatementCache(int32 Capacity)
+: Capacity(Capacity)
+, UseCounter(0)
+, Hits(0)
+, Misses(0)
+, Evictions(0)
+{}
+
+SqliteStatementCache::~SqliteStatementCache()
+{
+    Flush();
+}
+
+sqlite3_stmt* SqliteStatementCache::Checkout(const FSqliteStatementKey& Key)
+{
+    FScopeLock ScopeLock(&Lock);
+
+    FEntry* Entry = Entries.Find(Key);
+    if(!Entry || Entry->bInUse)
+    {
+        return nullptr;
+    }
+
+    ++Hits;
+    DATAACCESS_INC_COUNTER(StatementCacheHits, 1);
+    Entry->bInUse = true;
+    Entry->LastUsed = ++UseCounter;
+    return Entry->Statement;
+}
+
+sqlite3_stmt* SqliteStatementCache::Prepare(sqlite3* Database, const FSqliteStatementKey& Key, const FString& Sql)
+{
+    check(Database);
+
+    sqlite3_stmt* SqliteStatement = nullptr;
+    FTCHARToUTF8 Utf8Sql(*Sql, Sql.Len());
+    if(sqlite3_prepare_v2(Database, Utf8Sql.Get(), Utf8Sql.Length(), &SqliteStatement, nullptr) != SQLITE_OK)
+    {
+        sqlite3_finalize(SqliteStatement);
+        return nullptr;
+    }
+
+    FScopeLock ScopeLock(&Lock);
+    ++Misses;
+    DATAACCESS_INC_COUNTER(StatementCacheMisses, 1);
+
+    // The same shape is already checked out, e.g. by an open cursor.  Hand back an uncached statement.
+    if(Entries.Contains(Key))
+    {
+        return SqliteStatement;
+    }
+
+    if(Entries.Num() >= Capacity)
+    {
+        // Evict the least recently used statement that nobody is holding
+        const FSqliteStatementKey* EvictKey = nullptr;
+        uint64 OldestUse = MAX_uint64;
+        for(auto Itr = Entries.CreateConstIterator(); Itr; ++Itr)
+        {
+            if(!Itr.Value().bInUse && Itr.Value().LastUsed < OldestUse)
+            {
+                OldestUse = Itr.Value().LastUsed;
+                EvictKey = &Itr.Key();
+            }
+        }
+
+        if(!EvictKey)
+        {
+            return SqliteStatement;
+        }
+
+        sqlite3_stmt* EvictStatement = Entries.FindChecked(*EvictKey).Statement;
+        CachedKeys.Remove(EvictStatement);
+        Entries.Remove(FSqliteStatementKey(*EvictKey));
+        sqlite3_finalize(EvictStatement);
+        ++Evictions;
+        DATAACCESS_INC_COUNTER(StatementCacheEvictions, 1);
+    }
+
+    FEntry NewEntry;
+    NewEntry.Statement = SqliteStatement;
+    NewEntry.LastUsed = ++UseCounter;
+    NewEntry.bInUse = true;
+    Entries.Add(Key, NewEntry);
+    CachedKeys.Add(SqliteStatement, Key);
+
+    return SqliteStatement;
+}
+
+void SqliteStatementCache::Return(sqlite3_stmt* SqliteStatement)
+{
+    if(!SqliteStatement)
+    {
+        return;
+    }
+
+    FScopeLock ScopeLock(&Lock);
+
+    const FSqliteStatementKey* Key = CachedKeys.Find(SqliteStatement);
+    if(!Key)
+    {
+        sqlite3_finalize(SqliteStatement);
+        return;
+    }
+
+    sqlite3_reset(SqliteStatement);
+    sqlite3_clear_bindings(SqliteStatement);
+    Entries.FindChecked(*Key).bInUse = false;
+}
+
+void SqliteStatementCache::Flush()
+{
+    FScopeLock ScopeLock(&Lock);
+
+    for(auto Itr = Entries.CreateIterator(); Itr; ++Itr)
+    {
+        // Uncached statements are finalized on return, so the holder can still return it
+        if(!Itr.Value().bInUse)
+        {
+            sqlite3_finalize(Itr.Value().Statement);
+        }
+    }
+    Entries.Empty();
+    CachedKeys.Empty();
+}
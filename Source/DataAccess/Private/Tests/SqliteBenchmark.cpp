@@ -0,0 +1,425 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#include "DataAccessPrivatePCH.h"
+#include "AutomationTest.h"
+#include "SqliteDataResource.h"
+#include "SqliteDataHandler.h"
+#include "TestObject.h"
+#include "DataObjectPool.h"
+#include "DataAccessMetrics.h"
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FSqliteDataAccessBenchmark, "DataAccess.Benchmark", EAutomationTestFlags::ATF_ApplicationMask)
+
+namespace SqliteBenchmarkHelpers
+{
+    /** Number of timed calls of each single record operation */
+    const int32 SampleCount = 1000;
+
+    /** Records per CreateMany and UpdateMany call */
+    const int32 BatchSize = 1000;
+
+    /** Full table operations are slow at the larger sizes, they are only run a few times */
+    const int32 ScanSampleCount = 3;
+
+    /**
+     * Latency samples of one operation
+     */
+    struct FOperationSamples
+    {
+        FString Name;
+        TArray<double> Seconds;
+        int64 Rows;
+
+        explicit FOperationSamples(const TCHAR* Name)
+        : Name(Name)
+        , Rows(0)
+        {}
+
+        void Add(double StartTime, int32 SampleRows = 1)
+        {
+            Seconds.Add(FPlatformTime::Seconds() - StartTime);
+            Rows += SampleRows;
+        }
+
+        double GetPercentileMs(float Percentile, const TArray<double>& Sorted) const
+        {
+            int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+            return Sorted[Index] * 1000.0;
+        }
+
+        FString ToString() const
+        {
+            if(Seconds.Num() == 0)
+            {
+                return FString::Printf(TEXT("%-16s no samples"), *Name);
+            }
+
+            TArray<double> Sorted = Seconds;
+            Sorted.Sort();
+
+            double Total = 0.0;
+            for(double Sample : Sorted)
+            {
+                Total += Sample;
+            }
+
+            return FString::Printf(TEXT("%-16s %7i calls  %12.1f ops/s  %12.1f rows/s  p50 %9.3f ms  p99 %9.3f ms"),
+                *Name, Sorted.Num(), Sorted.Num() / Total, Rows / Total, GetPercentileMs(0.5f, Sorted), GetPercentileMs(0.99f, Sorted));
+        }
+    };
+
+    /**
+     * Delete the database and the files sqlite keeps next to it
+     */
+    void DeleteDatabase(const FString& DatabasePath)
+    {
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        PlatformFile.DeleteFile(*DatabasePath);
+        PlatformFile.DeleteFile(*(DatabasePath + TEXT("-wal")));
+        PlatformFile.DeleteFile(*(DatabasePath + TEXT("-shm")));
+        PlatformFile.DeleteFile(*(DatabasePath + TEXT("-journal")));
+    }
+}
+
+void FSqliteDataAccessBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+    OutBeautifiedNames.Add(TEXT("1k rows"));
+    OutTestCommands.Add(TEXT("1000"));
+    OutBeautifiedNames.Add(TEXT("100k rows"));
+    OutTestCommands.Add(TEXT("100000"));
+    OutBeautifiedNames.Add(TEXT("1M rows"));
+    OutTestCommands.Add(TEXT("1000000"));
+}
+
+bool FSqliteDataAccessBenchmark::RunTest(const FString& Parameters)
+{
+    using namespace SqliteBenchmarkHelpers;
+
+    const int32 RowCount = FMath::Max(FCString::Atoi(*Parameters), 1);
+    const int32 Samples = FMath::Min(SampleCount, RowCount);
+
+    // Same seed for the same size so runs are comparable between builds
+    FRandomStream Random(RowCount);
+    auto FillObject = [&Random, RowCount](UTestObject* Obj, int32 Index)
+    {
+        Obj->TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+        Obj->TestFloat = Random.FRand() * 1000.f;
+        Obj->TestBool = Random.FRand() < 0.5f;
+        Obj->TestString = FString::Printf(TEXT("Benchmark row %i"), Index);
+
+        // Mostly small arrays with the occasional large one
+        int32 ArraySize = Random.FRand() < 0.9f ? Random.RandRange(0, 16) : Random.RandRange(64, 1024);
+        Obj->TestArray.Reset(ArraySize);
+        for(int32 i = 0; i < ArraySize; ++i)
+        {
+            Obj->TestArray.Add(static_cast<int32>(Random.GetUnsignedInt()));
+        }
+    };
+
+    AddLogItem(TEXT("Creating benchmark database"));
+    FString DatabasePath = FPaths::ConvertRelativePathToFull(FPaths::AutomationTransientDir() / FString::Printf(TEXT("DataAccessBenchmark_%i.db"), RowCount));
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(DatabasePath), true);
+    DeleteDatabase(DatabasePath);
+
+    TSharedPtr<SqliteDataResource> DataResource = MakeShareable(new SqliteDataResource(DatabasePath));
+    DataResource->SetConnectionProfile("FastSaveGame");
+    if(!DataResource->Acquire())
+    {
+        AddError(TEXT("Benchmark database resource could not be acquired"));
+        return false;
+    }
+
+    TSharedPtr<IDataHandler> DataHandler = MakeShareable(new SqliteDataHandler(DataResource));
+    if(!DataHandler->Source(UTestObject::StaticClass()).EnsureTable())
+    {
+        AddError(TEXT("Benchmark table could not be created"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully created benchmark database"));
+
+#if DATAACCESS_METRICS
+    FDataAccessMetrics::Get().Reset();
+#endif
+
+    FOperationSamples CreateManySamples(TEXT("CreateMany"));
+    FOperationSamples CreateSamples(TEXT("Create"));
+    FOperationSamples FirstByIdSamples(TEXT("First by Id"));
+    FOperationSamples FirstByIndexSamples(TEXT("First by index"));
+    FOperationSamples CountSamples(TEXT("Count"));
+    FOperationSamples GetSamples(TEXT("Get"));
+    FOperationSamples GetPooledSamples(TEXT("Get pooled"));
+    FOperationSamples UpdateSamples(TEXT("Update"));
+    FOperationSamples UpdateManySamples(TEXT("UpdateMany"));
+    FOperationSamples UpdateWhereSamples(TEXT("UpdateWhere"));
+    FOperationSamples ExecuteQuerySamples(TEXT("ExecuteQuery"));
+    FOperationSamples CountAllSamples(TEXT("Count all"));
+    FOperationSamples IterateSamples(TEXT("Iterate all"));
+    FOperationSamples SumAllSamples(TEXT("Sum all"));
+    FOperationSamples SumGroupedSamples(TEXT("Sum grouped"));
+    FOperationSamples DeleteSamples(TEXT("Delete"));
+    FOperationSamples DeleteWhereSamples(TEXT("Delete where"));
+
+    AddLogItem(FString::Printf(TEXT("Loading %i rows"), RowCount));
+    {
+        TArray<UObject*> Batch;
+        for(int32 i = 0; i < FMath::Min(BatchSize, RowCount); ++i)
+        {
+            Batch.Add(NewObject<UTestObject>());
+        }
+
+        for(int32 Loaded = 0; Loaded < RowCount; Loaded += Batch.Num())
+        {
+            Batch.SetNum(FMath::Min(Batch.Num(), RowCount - Loaded));
+            for(int32 i = 0; i < Batch.Num(); ++i)
+            {
+                FillObject(CastChecked<UTestObject>(Batch[i]), Loaded + i);
+            }
+
+            double StartTime = FPlatformTime::Seconds();
+            if(!DataHandler->Source(UTestObject::StaticClass()).CreateMany(Batch))
+            {
+                AddError(TEXT("Error loading benchmark rows"));
+                return false;
+            }
+            CreateManySamples.Add(StartTime, Batch.Num());
+        }
+    }
+
+    AddLogItem(TEXT("Running single record operations"));
+    TArray<UObject*> CreatedObjs;
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        UTestObject* Obj = NewObject<UTestObject>();
+        FillObject(Obj, RowCount + i);
+
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Create(Obj))
+        {
+            AddError(TEXT("Error creating a benchmark row"));
+            return false;
+        }
+        CreateSamples.Add(StartTime);
+        CreatedObjs.Add(Obj);
+    }
+
+    UTestObject* ReadObj = NewObject<UTestObject>();
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        int32 Id = Random.RandRange(1, RowCount);
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, Id).First(ReadObj))
+        {
+            AddError(TEXT("Error reading a benchmark row by Id"));
+            return false;
+        }
+        FirstByIdSamples.Add(StartTime);
+    }
+
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        int32 TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+        double StartTime = FPlatformTime::Seconds();
+        bool bFound = DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).First(ReadObj);
+        FirstByIndexSamples.Add(StartTime, bFound ? 1 : 0);
+    }
+
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        int32 TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+        int32 Count;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).Count(Count))
+        {
+            AddError(TEXT("Error counting benchmark rows"));
+            return false;
+        }
+        CountSamples.Add(StartTime, Count);
+    }
+
+    // About ten rows share each TestInt, the array only has to be large enough for the unlucky values
+    TArray<UObject*> GetObjs;
+    for(int32 i = 0; i < 64; ++i)
+    {
+        GetObjs.Add(NewObject<UTestObject>());
+    }
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        TArray<UObject*> Results = GetObjs;
+        int32 TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+
+        // Get fills the passed objects without shrinking the array, count the matches untimed to know how many it read
+        int32 Matches;
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).Count(Matches))
+        {
+            AddError(TEXT("Error counting benchmark rows"));
+            return false;
+        }
+
+        double StartTime = FPlatformTime::Seconds();
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).Get(Results);
+        GetSamples.Add(StartTime, FMath::Min(Matches, Results.Num()));
+    }
+
+    FDataObjectPool Pool;
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        TArray<UObject*> Results;
+        int32 TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).Get(Results, &Pool))
+        {
+            AddError(TEXT("Error getting pooled benchmark rows"));
+            return false;
+        }
+        GetPooledSamples.Add(StartTime, Results.Num());
+        Pool.Release(Results);
+    }
+
+    for(UObject* Obj : CreatedObjs)
+    {
+        UTestObject* TestObj = CastChecked<UTestObject>(Obj);
+        TestObj->TestFloat = Random.FRand() * 1000.f;
+
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, TestObj->Id).Update(TestObj))
+        {
+            AddError(TEXT("Error updating a benchmark row"));
+            return false;
+        }
+        UpdateSamples.Add(StartTime);
+    }
+
+    for(int32 Offset = 0; Offset < CreatedObjs.Num(); Offset += 100)
+    {
+        TArray<UObject*> Batch;
+        for(int32 i = Offset; i < FMath::Min(Offset + 100, CreatedObjs.Num()); ++i)
+        {
+            CastChecked<UTestObject>(CreatedObjs[i])->TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+            Batch.Add(CreatedObjs[i]);
+        }
+
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).UpdateMany(Batch))
+        {
+            AddError(TEXT("Error updating benchmark rows"));
+            return false;
+        }
+        UpdateManySamples.Add(StartTime, Batch.Num());
+    }
+
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        int32 TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+        int32 Affected;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).Set("TestFloat", Random.FRand() * 1000.f).UpdateWhere(Affected))
+        {
+            AddError(TEXT("Error updating benchmark rows by condition"));
+            return false;
+        }
+        UpdateWhereSamples.Add(StartTime, Affected);
+    }
+
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        TArray< TSharedPtr<FJsonValue> > JsonArray;
+        FString Query = FString::Printf(TEXT("SELECT Id, TestInt, TestString FROM TestObject WHERE TestInt = %i"), Random.RandRange(0, FMath::Max(RowCount / 10, 1)));
+        double StartTime = FPlatformTime::Seconds();
+        DataHandler->ExecuteQuery(Query, JsonArray);
+        ExecuteQuerySamples.Add(StartTime, JsonArray.Num());
+    }
+
+    AddLogItem(TEXT("Running full table operations"));
+    for(int32 i = 0; i < ScanSampleCount; ++i)
+    {
+        int32 Count;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Count(Count))
+        {
+            AddError(TEXT("Error counting every benchmark row"));
+            return false;
+        }
+        CountAllSamples.Add(StartTime, Count);
+    }
+
+    for(int32 i = 0; i < ScanSampleCount; ++i)
+    {
+        int32 Rows = 0;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Iterate([&Rows](UObject*) { ++Rows; return true; }, ReadObj))
+        {
+            AddError(TEXT("Error iterating benchmark rows"));
+            return false;
+        }
+        IterateSamples.Add(StartTime, Rows);
+    }
+
+    const int32 TotalRows = RowCount + CreatedObjs.Num();
+    for(int32 i = 0; i < ScanSampleCount; ++i)
+    {
+        FDataValue Sum;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Sum("TestFloat", Sum))
+        {
+            AddError(TEXT("Error summing benchmark rows"));
+            return false;
+        }
+        SumAllSamples.Add(StartTime, TotalRows);
+    }
+
+    for(int32 i = 0; i < ScanSampleCount; ++i)
+    {
+        TArray<FDataAggregateGroup> Groups;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).GroupBy("TestBool").Sum("TestFloat", Groups))
+        {
+            AddError(TEXT("Error summing grouped benchmark rows"));
+            return false;
+        }
+        SumGroupedSamples.Add(StartTime, TotalRows);
+    }
+
+    AddLogItem(TEXT("Deleting created rows"));
+    for(UObject* Obj : CreatedObjs)
+    {
+        int32 Id = CastChecked<UTestObject>(Obj)->Id;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, Id).Delete())
+        {
+            AddError(TEXT("Error deleting a benchmark row"));
+            return false;
+        }
+        DeleteSamples.Add(StartTime);
+    }
+
+    AddLogItem(TEXT("Deleting rows by condition"));
+    for(int32 i = 0; i < Samples; ++i)
+    {
+        int32 TestInt = Random.RandRange(0, FMath::Max(RowCount / 10, 1));
+        int32 Affected;
+        double StartTime = FPlatformTime::Seconds();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).Delete(Affected))
+        {
+            AddError(TEXT("Error deleting benchmark rows by condition"));
+            return false;
+        }
+        DeleteWhereSamples.Add(StartTime, Affected);
+    }
+
+    AddLogItem(FString::Printf(TEXT("Results for %i rows:"), RowCount));
+    const FOperationSamples* Operations[] = { &CreateManySamples, &CreateSamples, &FirstByIdSamples, &FirstByIndexSamples, &CountSamples, &GetSamples, &GetPooledSamples,
+                                              &UpdateSamples, &UpdateManySamples, &UpdateWhereSamples, &ExecuteQuerySamples, &CountAllSamples, &IterateSamples,
+                                              &SumAllSamples, &SumGroupedSamples, &DeleteSamples, &DeleteWhereSamples };
+    for(const FOperationSamples* Operation : Operations)
+    {
+        AddLogItem(Operation->ToString());
+    }
+
+#if DATAACCESS_METRICS
+    FDataAccessMetrics::Get().Dump(*GLog);
+#endif
+
+    DataHandler.Reset();
+    DataResource->Release();
+    DeleteDatabase(DatabasePath);
+    return true;
+}
@@ -4,8 +4,60 @@
 #include "SqliteDataResource.h"
 #include "SqliteDataHandler.h"
 #include "TestObject.h"
+#include "DataObjectPool.h"
+#include "DataWriteBehindQueue.h"
+#include "DataAccessMetrics.h"
+#include "AsyncDataHandler.h"
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSqliteDataAccessTest, "DataAccess.Sqlite", EAutomationTestFlags::ATF_ApplicationMask)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSqliteAsyncDataAccessTest, "DataAccess.SqliteAsync", EAutomationTestFlags::ATF_ApplicationMask)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSqliteReaderPoolTest, "DataAccess.SqliteReaders", EAutomationTestFlags::ATF_ApplicationMask)
+
+namespace SqliteTestHelpers
+{
+    /** Counts the marked records through its own handler, so its reads go to the reader pinned to its thread */
+    class FReaderRunnable : public FRunnable
+    {
+    public:
+        FReaderRunnable(TSharedPtr<SqliteDataResource> DataResource, int32 TestInt)
+        : DataResource(DataResource)
+        , TestInt(TestInt)
+        , bSuccess(true)
+        , ReadCount(0)
+        {}
+        
+        virtual uint32 Run() override
+        {
+            SqliteDataHandler DataHandler(DataResource);
+            
+            // Every read sees a committed snapshot, so the count never goes back
+            int32 LastCount = 0;
+            while(StopCounter.GetValue() == 0 || ReadCount < 10)
+            {
+                int32 Count = -1;
+                if(!DataHandler.Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, TestInt).Count(Count) || Count < LastCount)
+                {
+                    bSuccess = false;
+                    break;
+                }
+                LastCount = Count;
+                ++ReadCount;
+            }
+            return 0;
+        }
+        
+        virtual void Stop() override
+        {
+            StopCounter.Increment();
+        }
+        
+        TSharedPtr<SqliteDataResource> DataResource;
+        int32 TestInt;
+        bool bSuccess;
+        int32 ReadCount;
+        FThreadSafeCounter StopCounter;
+    };
+}
 
 bool FSqliteDataAccessTest::RunTest(const FString& Parameters)
 {
@@ -30,6 +82,15 @@ bool FSqliteDataAccessTest::RunTest(const FString& Parameters)
     AddLogItem(TEXT("Successfully created SqliteDataHandler"));
     
     
+    AddLogItem(TEXT("Ensuring the test table"));
+    if(!DataHandler->Source(UTestObject::StaticClass()).EnsureTable())
+    {
+        AddError(TEXT("Test table does not match UTestObject"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully ensured the test table"));
+    
+    
     AddLogItem(TEXT("Creating test object"));
     UTestObject* TestObj = nullptr;
     TestObj = NewObject<UTestObject>();
@@ -191,6 +252,41 @@ bool FSqliteDataAccessTest::RunTest(const FString& Parameters)
     AddLogItem(TEXT("Successfully got all test object"));
 
     
+    AddLogItem(TEXT("Iterating all test objects"));
+    int32 IteratedCount = 0;
+    UTestObject* IterateObj = NewObject<UTestObject>();
+    if(!DataHandler->Source(UTestObject::StaticClass()).Iterate([&IteratedCount](UObject* RowObj) { ++IteratedCount; return true; }, IterateObj))
+    {
+        AddError(TEXT("Error iterating all records"));
+        return false;
+    }
+    
+    if(IteratedCount != Count)
+    {
+        AddError(TEXT("Iterated count does not match count"));
+    }
+    AddLogItem(TEXT("Successfully iterated all test objects"));
+
+    
+    AddLogItem(TEXT("Getting all test objects from a pool"));
+    FDataObjectPool ObjectPool;
+    TArray<UObject*> PooledObjects;
+    if(!DataHandler->Source(UTestObject::StaticClass()).Get(PooledObjects, &ObjectPool) || PooledObjects.Num() != Count)
+    {
+        AddError(TEXT("Error getting all records from a pool"));
+        return false;
+    }
+    
+    UObject* FirstPooledObject = PooledObjects[0];
+    ObjectPool.Release(PooledObjects);
+    if(!DataHandler->Source(UTestObject::StaticClass()).Get(PooledObjects, &ObjectPool) || !PooledObjects.Contains(FirstPooledObject))
+    {
+        AddError(TEXT("Pooled objects were not recycled"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully got all test objects from a pool"));
+
+    
     AddLogItem(TEXT("Deleting test object"));
     if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(TestObj->Id)).Delete())
     {
@@ -200,6 +296,548 @@ bool FSqliteDataAccessTest::RunTest(const FString& Parameters)
     AddLogItem(TEXT("Successfully deleted test object"));
     
 
+    AddLogItem(TEXT("Creating and updating a batch of test objects"));
+    TArray<UObject*> BatchObjects;
+    for(int32 i = 0; i < 10; ++i)
+    {
+        UTestObject* BatchObj = NewObject<UTestObject>();
+        BatchObj->TestInt = i;
+        BatchObjects.Add(BatchObj);
+    }
+    if(!DataHandler->Source(UTestObject::StaticClass()).CreateMany(BatchObjects))
+    {
+        AddError(TEXT("Error creating a batch of records"));
+        return false;
+    }
+    
+    for(UObject* BatchObj : BatchObjects)
+    {
+        if(CastChecked<UTestObject>(BatchObj)->Id == -1)
+        {
+            AddError(TEXT("Batch object not correctly set after creating records"));
+            return false;
+        }
+        CastChecked<UTestObject>(BatchObj)->TestInt += 100;
+    }
+    
+    if(!DataHandler->Source(UTestObject::StaticClass()).UpdateMany(BatchObjects))
+    {
+        AddError(TEXT("Error updating a batch of records"));
+        return false;
+    }
+    
+    TestObj2 = NewObject<UTestObject>();
+    if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(CastChecked<UTestObject>(BatchObjects[9])->Id)).First(TestObj2) || TestObj2->TestInt != 109)
+    {
+        AddError(TEXT("Updated batch object and read object do not match"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully created and updated a batch of test objects"));
+    
+
+    AddLogItem(TEXT("Coalescing updates in a write behind queue"));
+    {
+        FDataWriteBehindQueue WriteBehindQueue(DataHandler.ToSharedRef(), 0.f);
+        UTestObject* QueuedObj = CastChecked<UTestObject>(BatchObjects[0]);
+        for(int32 i = 0; i < 3; ++i)
+        {
+            QueuedObj->TestInt = 200 + i;
+            WriteBehindQueue.Update(QueuedObj);
+        }
+        
+        if(WriteBehindQueue.Num() != 1 || !WriteBehindQueue.Flush() || WriteBehindQueue.Num() != 0)
+        {
+            AddError(TEXT("Error flushing coalesced updates"));
+            return false;
+        }
+        
+        TestObj2 = NewObject<UTestObject>();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(QueuedObj->Id)).First(TestObj2) || TestObj2->TestInt != 202)
+        {
+            AddError(TEXT("Flushed object and read object do not match"));
+            return false;
+        }
+        
+        // A record deleted while its update is queued must not block the queue
+        UTestObject* DeletedObj = NewObject<UTestObject>();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Create(DeletedObj))
+        {
+            AddError(TEXT("Error creating a record to delete while queued"));
+            return false;
+        }
+        DeletedObj->TestInt = 7;
+        QueuedObj->TestInt = 203;
+        WriteBehindQueue.Update(DeletedObj);
+        WriteBehindQueue.Update(QueuedObj);
+        DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, DeletedObj->Id).Delete();
+        if(!WriteBehindQueue.Flush() || WriteBehindQueue.Num() != 0)
+        {
+            AddError(TEXT("Flushing an update of a deleted record failed"));
+            return false;
+        }
+        
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, QueuedObj->Id).First(TestObj2) || TestObj2->TestInt != 203)
+        {
+            AddError(TEXT("Update queued next to a deleted record was not written"));
+            return false;
+        }
+        DeletedObj->ConditionalBeginDestroy();
+    }
+    AddLogItem(TEXT("Successfully coalesced updates in a write behind queue"));
+    
+
+    // Writes through a second resource are invisible to the first one's snapshots, they show which columns it writes
+    // and which reads it serves without going to the database
+    TSharedPtr<SqliteDataResource> OutsideResource = MakeShareable(new SqliteDataResource(FString(FPaths::GameDir() + "/Data/Test.db")));
+    if(!OutsideResource->Acquire())
+    {
+        AddError(TEXT("Second test database resource could not be acquired"));
+        return false;
+    }
+    SqliteDataHandler OutsideHandler(OutsideResource);
+    
+    
+    AddLogItem(TEXT("Updating only changed columns"));
+    DataResource->SetChangeTracking(true);
+    {
+        UTestObject* TrackedObj = NewObject<UTestObject>();
+        int32 TrackedId = CastChecked<UTestObject>(BatchObjects[1])->Id;
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(TrackedId)).First(TrackedObj))
+        {
+            AddError(TEXT("Error reading a tracked record"));
+            return false;
+        }
+        
+        int32 Affected = 0;
+        if(!OutsideHandler.Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, TrackedId).Set("TestInt", FDataValue(777)).UpdateWhere(Affected) || Affected != 1)
+        {
+            AddError(TEXT("Error changing a tracked record through a second resource"));
+            return false;
+        }
+        
+#if DATAACCESS_METRICS
+        const int64 RowsWrittenBefore = FDataAccessMetrics::Get().GetCounter(EDataAccessCounter::RowsWritten);
+#endif
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(TrackedId)).Update(TrackedObj))
+        {
+            AddError(TEXT("Unchanged tracked update failed"));
+            return false;
+        }
+#if DATAACCESS_METRICS
+        if(FDataAccessMetrics::Get().GetCounter(EDataAccessCounter::RowsWritten) != RowsWrittenBefore)
+        {
+            AddError(TEXT("Unchanged tracked update wrote a row"));
+            return false;
+        }
+#endif
+        
+        // Skipped updates leave the outside value alone, and so do updates of other columns
+        TestObj2 = NewObject<UTestObject>();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(TrackedId)).First(TestObj2) || TestObj2->TestInt != 777)
+        {
+            AddError(TEXT("Unchanged tracked update was written"));
+            return false;
+        }
+        
+        TrackedObj->TestString = "Changed String";
+        TestObj2 = NewObject<UTestObject>();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(TrackedId)).Update(TrackedObj)
+            || !DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(TrackedId)).First(TestObj2)
+            || TestObj2->TestString != TrackedObj->TestString || TestObj2->TestInt != 777)
+        {
+            AddError(TEXT("Tracked update did not write only the changed column"));
+            return false;
+        }
+    }
+    DataResource->SetChangeTracking(false);
+    AddLogItem(TEXT("Successfully updated only changed columns"));
+    
+
+    AddLogItem(TEXT("Reading through the identity map"));
+    DataResource->SetIdentityMap(true);
+    {
+        UTestObject* MappedObj = CastChecked<UTestObject>(BatchObjects[2]);
+        MappedObj->TestInt = 300;
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(MappedObj->Id)).Update(MappedObj))
+        {
+            AddError(TEXT("Error updating a mapped record"));
+            return false;
+        }
+        
+        int32 Affected = 0;
+        if(!OutsideHandler.Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, MappedObj->Id).Set("TestInt", FDataValue(301)).UpdateWhere(Affected) || Affected != 1)
+        {
+            AddError(TEXT("Error changing a mapped record through a second resource"));
+            return false;
+        }
+        
+        // Served from the map, the database already holds the outside value
+        TestObj2 = NewObject<UTestObject>();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(MappedObj->Id)).First(TestObj2) || TestObj2->TestInt != 300 || TestObj2->Id != MappedObj->Id)
+        {
+            AddError(TEXT("Mapped object was not served from the identity map"));
+            return false;
+        }
+        
+        // A mapped record read with Select goes to the database and must still only fill the selected properties
+        UTestObject* SelectedObj = NewObject<UTestObject>();
+        SelectedObj->TestString = "Not Selected";
+        if(!DataHandler->Source(UTestObject::StaticClass()).Select({ FName("TestInt") }).Where("Id", EDataHandlerOperator::Equals, MappedObj->Id).First(SelectedObj) || SelectedObj->TestInt != 301 || SelectedObj->TestString != "Not Selected")
+        {
+            AddError(TEXT("Select of a mapped record was not read from the database or wrote unselected properties"));
+            return false;
+        }
+        
+        // Keep later blocks working with the value the batch object holds
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(MappedObj->Id)).Update(MappedObj))
+        {
+            AddError(TEXT("Error updating a mapped record"));
+            return false;
+        }
+    }
+    DataResource->SetIdentityMap(false);
+    OutsideResource->Release();
+    AddLogItem(TEXT("Successfully read through the identity map"));
+    
+
+    AddLogItem(TEXT("Querying with typed conditions"));
+    {
+        UTestObject* BatchObj = CastChecked<UTestObject>(BatchObjects[2]);
+        UTestObject* TypedObj = NewObject<UTestObject>();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, BatchObj->Id).First(TypedObj) || TypedObj->Id != BatchObj->Id)
+        {
+            AddError(TEXT("Error reading a record by a typed Id"));
+            return false;
+        }
+        
+        int32 TypedCount = 0;
+        int32 LegacyCount = 0;
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestFloat", EDataHandlerOperator::GreaterThanOrEqualTo, 0.5).And().Where("TestBool", EDataHandlerOperator::Equals, true).Count(TypedCount);
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestFloat", EDataHandlerOperator::GreaterThanOrEqualTo, "0.5").And().Where("TestBool", EDataHandlerOperator::Equals, "1").Count(LegacyCount);
+        if(TypedCount != LegacyCount)
+        {
+            AddError(TEXT("Typed and string conditions do not match the same records"));
+            return false;
+        }
+    }
+    AddLogItem(TEXT("Successfully queried with typed conditions"));
+    
+
+    AddLogItem(TEXT("Running a compiled query"));
+    {
+        FCompiledDataQuery ById = DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FDataValue()).Compile();
+        for(int32 i = 0; i < 3; ++i)
+        {
+            UTestObject* BatchObj = CastChecked<UTestObject>(BatchObjects[i]);
+            UTestObject* CompiledObj = NewObject<UTestObject>();
+            if(!DataHandler->Query(ById.SetParameter(0, BatchObj->Id)).First(CompiledObj) || CompiledObj->Id != BatchObj->Id)
+            {
+                AddError(TEXT("Compiled query did not read the record of its parameter"));
+                return false;
+            }
+        }
+    }
+    AddLogItem(TEXT("Successfully ran a compiled query"));
+    
+
+    AddLogItem(TEXT("Selecting some fields"));
+    {
+        UTestObject* BatchObj = CastChecked<UTestObject>(BatchObjects[2]);
+        UTestObject* ProjectedObj = NewObject<UTestObject>();
+        ProjectedObj->TestString = TEXT("untouched");
+        if(!DataHandler->Source(UTestObject::StaticClass()).Select({ FName("TestInt") }).Where("Id", EDataHandlerOperator::Equals, BatchObj->Id).First(ProjectedObj) ||
+           ProjectedObj->Id != BatchObj->Id || ProjectedObj->TestInt != BatchObj->TestInt || ProjectedObj->TestString != TEXT("untouched"))
+        {
+            AddError(TEXT("Select read fields that were not selected or missed selected ones"));
+            return false;
+        }
+    }
+    AddLogItem(TEXT("Successfully selected some fields"));
+    
+
+    AddLogItem(TEXT("Paging through ordered records"));
+    {
+        // Records sharing the ordered value span page boundaries and must be read exactly once
+        TArray<UObject*> TiedObjects;
+        for(int32 i = 0; i < 5; ++i)
+        {
+            UTestObject* TiedObj = NewObject<UTestObject>();
+            TiedObj->TestInt = 500;
+            TiedObjects.Add(TiedObj);
+        }
+        if(!DataHandler->Source(UTestObject::StaticClass()).CreateMany(TiedObjects))
+        {
+            AddError(TEXT("Error creating records with tied values"));
+            return false;
+        }
+        
+        int32 Expected = 0;
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).Count(Expected);
+        
+        TArray<UObject*> Page;
+        TArray<UObject*> FirstPage;
+        UObject* LastRow = nullptr;
+        TSet<int32> SeenIds;
+        int32 Seen = 0;
+        int32 PreviousInt = MAX_int32;
+        do
+        {
+            IDataHandler& PageQuery = DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).OrderBy("TestInt", EDataSortOrder::Descending).Limit(3);
+            if(LastRow)
+            {
+                PageQuery.After(LastRow);
+            }
+            if(!PageQuery.Get(Page, nullptr))
+            {
+                AddError(TEXT("Error reading a page of records"));
+                return false;
+            }
+            
+            for(UObject* PageObj : Page)
+            {
+                if(CastChecked<UTestObject>(PageObj)->TestInt > PreviousInt)
+                {
+                    AddError(TEXT("Page is not in descending order"));
+                    return false;
+                }
+                PreviousInt = CastChecked<UTestObject>(PageObj)->TestInt;
+                SeenIds.Add(CastChecked<UTestObject>(PageObj)->Id);
+            }
+            
+            if(!LastRow)
+            {
+                FirstPage = Page;
+            }
+            Seen += Page.Num();
+            LastRow = Page.Num() > 0 ? Page.Last() : nullptr;
+        } while(Page.Num() == 3);
+        
+        if(Seen != Expected || SeenIds.Num() != Seen)
+        {
+            AddError(FString::Printf(TEXT("Paging read %i records, %i distinct, %i match"), Seen, SeenIds.Num(), Expected));
+            return false;
+        }
+        
+        UTestObject* OffsetObj = NewObject<UTestObject>();
+        if(FirstPage.Num() < 2 ||
+           !DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).OrderBy("TestInt", EDataSortOrder::Descending).Offset(1).First(OffsetObj) ||
+           OffsetObj->Id != CastChecked<UTestObject>(FirstPage[1])->Id)
+        {
+            AddError(TEXT("First with an offset did not read the second ordered record"));
+            return false;
+        }
+        
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, 500).Delete();
+    }
+    AddLogItem(TEXT("Successfully paged through ordered records"));
+    
+
+    AddLogItem(TEXT("Aggregating in the database"));
+    {
+        int64 ExpectedSum = 0;
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).Iterate([&ExpectedSum](UObject* RowObj)
+        {
+            ExpectedSum += CastChecked<UTestObject>(RowObj)->TestInt;
+            return true;
+        });
+        
+        FDataValue Total;
+        FDataValue Average;
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).Sum("TestInt", Total) || Total.AsInt64() != ExpectedSum ||
+           !DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).Avg("TestInt", Average) || Average.GetType() != EDataValueType::Real)
+        {
+            AddError(TEXT("Sum or average does not match the records"));
+            return false;
+        }
+        
+        TArray<FDataAggregateGroup> Groups;
+        int64 GroupedSum = 0;
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).GroupBy("TestBool").Sum("TestInt", Groups))
+        {
+            AddError(TEXT("Error running a grouped sum"));
+            return false;
+        }
+        for(const FDataAggregateGroup& Group : Groups)
+        {
+            GroupedSum += Group.Value.AsInt64();
+        }
+        if(GroupedSum != ExpectedSum || Groups.Num() == 0 || Groups[0].Keys.Num() != 1)
+        {
+            AddError(TEXT("Grouped sums do not add up to the total"));
+            return false;
+        }
+        
+        // Ordering and limiting picks the group with the highest key
+        const FDataAggregateGroup* HighestGroup = &Groups[0];
+        for(const FDataAggregateGroup& Group : Groups)
+        {
+            HighestGroup = Group.Keys[0].AsInt64() > HighestGroup->Keys[0].AsInt64() ? &Group : HighestGroup;
+        }
+        TArray<FDataAggregateGroup> LimitedGroups;
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).GroupBy("TestBool").OrderBy("TestBool", EDataSortOrder::Descending).Limit(1).Sum("TestInt", LimitedGroups) ||
+           LimitedGroups.Num() != 1 || LimitedGroups[0].Keys[0].AsInt64() != HighestGroup->Keys[0].AsInt64() || LimitedGroups[0].Value.AsInt64() != HighestGroup->Value.AsInt64())
+        {
+            AddError(TEXT("Ordered and limited groups do not match"));
+            return false;
+        }
+    }
+    AddLogItem(TEXT("Successfully aggregated in the database"));
+    
+
+    AddLogItem(TEXT("Updating and deleting without reading records"));
+    DataResource->SetIdentityMap(true);
+    {
+        UTestObject* MappedObj = CastChecked<UTestObject>(BatchObjects[3]);
+        UTestObject* ReadObj = NewObject<UTestObject>();
+        DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, MappedObj->Id).First(ReadObj);
+        int32 PreviousInt = ReadObj->TestInt;
+        
+        int32 Expected = 0;
+        int32 Affected = 0;
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).Count(Expected);
+        if(!DataHandler->Source(UTestObject::StaticClass()).Increment("TestInt", 1000).Set("TestString", TEXT("bulk")).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, 100).UpdateWhere(Affected) || Affected != Expected)
+        {
+            AddError(FString::Printf(TEXT("Set based update changed %i records, %i match"), Affected, Expected));
+            return false;
+        }
+        
+        // The identity map must not serve the value from before the update
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, MappedObj->Id).First(ReadObj) || ReadObj->TestInt != PreviousInt + 1000 || ReadObj->TestString != TEXT("bulk"))
+        {
+            AddError(TEXT("Record read after a set based update does not match"));
+            return false;
+        }
+        
+        // Compiled queries keep their assignments
+        FCompiledDataQuery Undo = DataHandler->Source(UTestObject::StaticClass()).Decrement("TestInt", 1000).Where("TestInt", EDataHandlerOperator::GreaterThanOrEqualTo, FDataValue()).Compile();
+        if(!DataHandler->Query(Undo.SetParameter(0, 1100)).UpdateWhere(Affected) || Affected != Expected)
+        {
+            AddError(TEXT("Error undoing a set based update"));
+            return false;
+        }
+        
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, -1).Delete(Affected) || Affected != 0)
+        {
+            AddError(TEXT("Delete of no records did not report 0 affected"));
+            return false;
+        }
+    }
+    DataResource->SetIdentityMap(false);
+    AddLogItem(TEXT("Successfully updated and deleted without reading records"));
+    
+
+    AddLogItem(TEXT("Round tripping multi byte text"));
+    {
+        UTestObject* TextObj = NewObject<UTestObject>();
+        TextObj->TestString = TEXT("Gr\u00F6\u00DFe \u2713 \u65E5\u672C");
+        if(!DataHandler->Source(UTestObject::StaticClass()).Create(TextObj))
+        {
+            AddError(TEXT("Error creating a record with multi byte text"));
+            return false;
+        }
+        
+        UTestObject* ReadTextObj = NewObject<UTestObject>();
+        if(!DataHandler->Source(UTestObject::StaticClass()).Where("TestString", EDataHandlerOperator::Equals, TextObj->TestString).First(ReadTextObj) || ReadTextObj->TestString != TextObj->TestString)
+        {
+            AddError(TEXT("Multi byte text did not round trip"));
+            return false;
+        }
+        DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(TextObj->Id)).Delete();
+    }
+    AddLogItem(TEXT("Successfully round tripped multi byte text"));
+    
+
+    AddLogItem(TEXT("Inspecting query plans"));
+    {
+        SqliteQueryPlanAdvisor& Advisor = DataResource->GetQueryPlanAdvisor();
+        Advisor.SetEnabled(true);
+        Advisor.SetLargeTableRows(0);
+        
+        int32 PlanCount;
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestFloat", EDataHandlerOperator::GreaterThan, "0").And().Where("TestBool", EDataHandlerOperator::Equals, "1").Count(PlanCount);
+        DataHandler->Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, "300").Count(PlanCount);
+        
+        TArray<FString> Recommendations;
+        Advisor.GetRecommendations(Recommendations);
+        Advisor.SetEnabled(false);
+        Advisor.Reset();
+        
+        // TestInt is indexed, the other shape has to scan and wants the equality column first
+        if(Recommendations.Num() != 1 || !Recommendations[0].Contains(TEXT("ON TestObject (TestBool,TestFloat)")))
+        {
+            AddError(TEXT("Unexpected index recommendations"));
+            return false;
+        }
+    }
+    AddLogItem(TEXT("Successfully inspected query plans"));
+    
+
+#if DATAACCESS_METRICS
+    AddLogItem(TEXT("Checking performance counters"));
+    {
+        const FDataAccessMetrics& Metrics = FDataAccessMetrics::Get();
+        if(Metrics.GetOperation(EDataAccessOperation::Create).GetCount() == 0 || Metrics.GetOperation(EDataAccessOperation::First).GetPercentileMs(0.99f) < Metrics.GetOperation(EDataAccessOperation::First).GetPercentileMs(0.5f) ||
+           Metrics.GetCounter(EDataAccessCounter::RowsWritten) == 0 || Metrics.GetCounter(EDataAccessCounter::RowsRead) == 0 || Metrics.GetCounter(EDataAccessCounter::StatementCacheHits) == 0)
+        {
+            AddError(TEXT("Performance counters were not updated"));
+            return false;
+        }
+        Metrics.Dump(*GLog);
+    }
+    AddLogItem(TEXT("Successfully checked performance counters"));
+#endif
+    
+
+    AddLogItem(TEXT("Rolling back a transaction scope"));
+    UTestObject* RolledBackObj = NewObject<UTestObject>();
+    {
+        FDataTransactionScope Transaction(*DataHandler, EDataTransactionMode::Immediate);
+        if(!Transaction.IsActive() || !DataHandler->Source(UTestObject::StaticClass()).Create(RolledBackObj))
+        {
+            AddError(TEXT("Error creating a record inside of a transaction"));
+            return false;
+        }
+    }
+    
+    if(DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, FString::FromInt(RolledBackObj->Id)).First(NewObject<UTestObject>()))
+    {
+        AddError(TEXT("Record created inside of a rolled back transaction exists"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully rolled back a transaction scope"));
+    
+
+    AddLogItem(TEXT("Releasing a resource with an open cursor"));
+    {
+        TSharedPtr<SqliteDataResource> CursorResource = MakeShareable(new SqliteDataResource(FString(FPaths::GameDir() + "/Data/Test.db")));
+        if(!CursorResource->Acquire())
+        {
+            AddError(TEXT("Cursor resource could not be acquired"));
+            return false;
+        }
+        
+        SqliteDataHandler CursorHandler(CursorResource);
+        TSharedPtr<IDataCursor> Cursor = CursorHandler.Source(UTestObject::StaticClass()).OpenCursor();
+        if(!Cursor.IsValid() || !Cursor->Next())
+        {
+            AddError(TEXT("Error opening a cursor"));
+            return false;
+        }
+        
+        // The connection stays open until the cursor returns its statement, which is then finalized
+        CursorResource->Release();
+        UTestObject* CursorObj = NewObject<UTestObject>();
+        if(!Cursor->Read(CursorObj) || CursorObj->Id == -1)
+        {
+            AddError(TEXT("Error reading from a cursor outliving its resource"));
+            return false;
+        }
+        Cursor.Reset();
+        CursorObj->ConditionalBeginDestroy();
+    }
+    AddLogItem(TEXT("Successfully released a resource with an open cursor"));
+    
+
     AddLogItem(TEXT("Testing expected fail cases"));
     TestObj = NewObject<UTestObject>();
     if(DataHandler->Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, "-1").First(TestObj))
@@ -235,3 +873,179 @@ bool FSqliteDataAccessTest::RunTest(const FString& Parameters)
     
     return true;
 }
+
+bool FSqliteAsyncDataAccessTest::RunTest(const FString& Parameters)
+{
+    AddLogItem(TEXT("Creating FAsyncDataHandler"));
+    if(!FPlatformFileManager::Get().GetPlatformFile().FileExists(*FString(FPaths::GameDir() + "/Data/Test.db")))
+    {
+        AddError(TEXT("Test database does not exist at \"" + FPaths::GameDir() + "/Data/Test.db\""));
+        return false;
+    }
+    
+    FAsyncDataHandler AsyncHandler(FString(FPaths::GameDir() + "/Data/Test.db"));
+    TFuture<bool> Ensured = AsyncHandler.Enqueue([](IDataHandler& Handler) { return Handler.Source(UTestObject::StaticClass()).EnsureTable(); });
+    if(!Ensured.Get())
+    {
+        AddError(TEXT("Test table does not match UTestObject"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully created FAsyncDataHandler"));
+    
+    
+    AddLogItem(TEXT("Creating a record on the database thread"));
+    UTestObject* TestObj = NewObject<UTestObject>();
+    TestObj->TestInt = 42;
+    TestObj->TestString = "Async Test String";
+    TestObj->TestArray.Add(42);
+    
+    TFuture<bool> Created = AsyncHandler.Create(TestObj);
+    
+    // Changes made while the command is queued must not reach the database, the command works on a copy
+    TestObj->TestInt = 43;
+    AsyncHandler.Flush();
+    if(!Created.Get() || TestObj->Id == -1)
+    {
+        AddError(TEXT("Error creating a new record asynchronously"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully created a record on the database thread"));
+    
+    
+    AddLogItem(TEXT("Reading the record on the database thread"));
+    UTestObject* ReadObj = NewObject<UTestObject>();
+    TFuture<bool> Read = AsyncHandler.First(ReadObj, TestObj->Id);
+    AsyncHandler.Flush();
+    if(!Read.Get() || ReadObj->Id != TestObj->Id || ReadObj->TestInt != 42 || ReadObj->TestString != TestObj->TestString || ReadObj->TestArray != TestObj->TestArray)
+    {
+        AddError(TEXT("Record read asynchronously does not match the created one"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully read the record on the database thread"));
+    
+    
+    AddLogItem(TEXT("Updating the record with a callback"));
+    TestObj->TestInt = 44;
+    TFuture<bool> Updated = AsyncHandler.Update(TestObj);
+    
+    bool bCallbackRun = false;
+    bool bCallbackSuccess = false;
+    UObject* CallbackObj = NewObject<UTestObject>();
+    int32 Id = TestObj->Id;
+    AsyncHandler.Enqueue([CallbackObj, Id](IDataHandler& Handler) { return Handler.Source(UTestObject::StaticClass()).Where("Id", EDataHandlerOperator::Equals, Id).First(CallbackObj); },
+                         [&bCallbackRun, &bCallbackSuccess](bool bSuccess) { bCallbackRun = true; bCallbackSuccess = bSuccess; },
+                         TArray<UObject*>({ CallbackObj }));
+    AsyncHandler.Flush();
+    if(!Updated.Get() || !bCallbackRun || !bCallbackSuccess || CastChecked<UTestObject>(CallbackObj)->TestInt != 44)
+    {
+        AddError(TEXT("Error updating a record asynchronously"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully updated the record with a callback"));
+    
+    
+    AddLogItem(TEXT("Deleting the record on the database thread"));
+    TFuture<bool> Deleted = AsyncHandler.Delete(TestObj);
+    TFuture<bool> ReadDeleted = AsyncHandler.First(ReadObj, TestObj->Id);
+    AsyncHandler.Flush();
+    if(!Deleted.Get() || ReadDeleted.Get())
+    {
+        AddError(TEXT("Error deleting a record asynchronously"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully deleted the record on the database thread"));
+    
+    TestObj->ConditionalBeginDestroy();
+    TestObj = nullptr;
+    ReadObj->ConditionalBeginDestroy();
+    ReadObj = nullptr;
+    CallbackObj->ConditionalBeginDestroy();
+    CallbackObj = nullptr;
+    
+    return true;
+}
+
+bool FSqliteReaderPoolTest::RunTest(const FString& Parameters)
+{
+    AddLogItem(TEXT("Creating SqliteDataResource with readers"));
+    if(!FPlatformFileManager::Get().GetPlatformFile().FileExists(*FString(FPaths::GameDir() + "/Data/Test.db")))
+    {
+        AddError(TEXT("Test database does not exist at \"" + FPaths::GameDir() + "/Data/Test.db\""));
+        return false;
+    }
+    
+    TSharedPtr<SqliteDataResource> DataResource = MakeShareable(new SqliteDataResource(FString(FPaths::GameDir() + "/Data/Test.db"), 64, 2));
+    if(!DataResource->Acquire())
+    {
+        AddError(TEXT("Test database resource could not be acquired"));
+        return false;
+    }
+    
+    SqliteDataHandler DataHandler(DataResource);
+    if(!DataHandler.Source(UTestObject::StaticClass()).EnsureTable())
+    {
+        AddError(TEXT("Test table does not match UTestObject"));
+        return false;
+    }
+    
+    if(DataResource->GetReaderCount() == 0)
+    {
+        AddWarning(TEXT("Test database cannot use WAL mode, reads go through the writer"));
+    }
+    AddLogItem(TEXT("Successfully created SqliteDataResource with readers"));
+    
+    
+    AddLogItem(TEXT("Reading on a second thread while the writer commits"));
+    const int32 MarkerInt = 9009;
+    const int32 WriteCount = 20;
+    SqliteTestHelpers::FReaderRunnable Runnable(DataResource, MarkerInt);
+    FRunnableThread* Thread = FRunnableThread::Create(&Runnable, TEXT("DataAccessReaderTest"), 0, TPri_Normal);
+    
+    bool bWritten = true;
+    UTestObject* TestObj = NewObject<UTestObject>();
+    for(int32 i = 0; i < WriteCount && bWritten; ++i)
+    {
+        TestObj->Id = -1;
+        TestObj->TestInt = MarkerInt;
+        bWritten = DataHandler.BeginTransaction() && DataHandler.Source(UTestObject::StaticClass()).Create(TestObj) && DataHandler.Commit();
+    }
+    
+    Runnable.Stop();
+    Thread->WaitForCompletion();
+    delete Thread;
+    Thread = nullptr;
+    
+    if(!bWritten)
+    {
+        AddError(TEXT("Error committing records while a reader is open"));
+        return false;
+    }
+    
+    if(!Runnable.bSuccess)
+    {
+        AddError(TEXT("Reader thread failed or saw a commit disappear"));
+        return false;
+    }
+    
+    int32 Count = 0;
+    if(!DataHandler.Source(UTestObject::StaticClass()).Where("TestInt", EDataHandlerOperator::Equals, MarkerInt).Count(Count) || Count != WriteCount)
+    {
+        AddError(FString::Printf(TEXT("Expected %i committed records, found %i"), WriteCount, Count));
+        return false;
+    }
+    AddLogItem(FString::Printf(TEXT("Successfully read %i times on a second thread"), Runnable.ReadCount));
+    
+    
+    AddLogItem(TEXT("Releasing the resource"));
+    if(!DataHandler.Source(UTestObject::StaticClass()).Delete() || !DataResource->Release() || DataResource->GetReaderCount() != 0)
+    {
+        AddError(TEXT("Problems cleaning up"));
+        return false;
+    }
+    AddLogItem(TEXT("Successfully released the resource"));
+    
+    TestObj->ConditionalBeginDestroy();
+    TestObj = nullptr;
+    
+    return true;
+}
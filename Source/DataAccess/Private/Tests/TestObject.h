@@ -21,7 +21,7 @@ private:
 	UPROPERTY(meta = (SaveToDatabase = "true"))
     int32 Id;
     
-    UPROPERTY(meta = (SaveToDatabase="true"))
+    UPROPERTY(meta = (SaveToDatabase="true", DatabaseIndex="true"))
     int32 TestInt;
     
 	UPROPERTY(meta = (SaveToDatabase = "true"))
@@ -46,4 +46,5 @@ private:
     int32 LastUpdateTimestamp;
     
     friend class FSqliteDataAccessTest;
+    friend class FSqliteDataAccessBenchmark;
 };
\ No newline at end of file
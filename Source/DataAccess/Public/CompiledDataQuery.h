@@ -0,0 +1,97 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#pragma once
+
+#include "DataValue.h"
+
+/**
+ * A query built once with the fluent builder and run many times with different parameter values.  Add the Where
+ * clauses with placeholder values, compile, then set the parameters by the order their clauses were added:
+ *
+ *     FCompiledDataQuery ByTeam = Handler.Source(UUnit::StaticClass()).Where("TeamId", EDataHandlerOperator::Equals, FDataValue()).Compile();
+ *     Handler.Query(ByTeam.SetParameter(0, TeamId)).Get(Units, &Pool);
+ *
+ * The shape of the query is shared between copies, so copying a compiled query only copies its parameter values.
+ */
+class DATAACCESS_API FCompiledDataQuery
+{
+public:
+    /** Parts of a query that do not change between runs */
+    struct FShape
+    {
+        UClass* Source;
+
+        /** Field names, operators, placeholders and conjunctions in the order they were added */
+        TArray<FString> Parts;
+
+        /** Parts joined into the WHERE clause, empty if there are none */
+        FString WhereClause;
+
+        /** Fields chosen with Select as resolved by the handler that compiled the query, 0 for every field */
+        uint64 SelectMask;
+
+        /** Select could not be resolved into the mask, running the query fails */
+        bool bSelectFailed;
+
+        /** OrderBy field names, each followed by ASC or DESC */
+        TArray<FString> OrderParts;
+
+        /** GroupBy field names */
+        TArray<FString> GroupParts;
+
+        /** Set, Increment and Decrement assignments and their values for UpdateWhere.  The values are not parameters. */
+        TArray<FString> SetParts;
+        TArray<FDataValue> SetValues;
+
+        /** Limit and Offset the query starts with, INDEX_NONE and 0 if not set */
+        int32 Limit;
+        int32 Offset;
+    };
+
+    FCompiledDataQuery()
+    {}
+
+    FCompiledDataQuery(const TSharedRef<const FShape, ESPMode::ThreadSafe>& Shape, const TArray<FDataValue>& Parameters)
+    : Shape(Shape)
+    , Parameters(Parameters)
+    {}
+
+    bool IsValid() const { return Shape.IsValid(); }
+
+    /**
+     * @return  source class of the query
+     */
+    UClass* GetSource() const { return Shape.IsValid() ? Shape->Source : nullptr; }
+
+    /**
+     * @return  number of Where clauses, and so of parameters
+     */
+    int32 NumParameters() const { return Parameters.Num(); }
+
+    /**
+     * Set the value a Where clause compares with
+     *
+     * @param   Index       0 based index of the clause in the order it was added
+     * @param   Value       value to bind
+     * @return              this query, so it can be set and run in one expression
+     */
+    FCompiledDataQuery& SetParameter(int32 Index, const FDataValue& Value)
+    {
+        check(Parameters.IsValidIndex(Index));
+        Parameters[Index] = Value;
+        return *this;
+    }
+
+    template<typename T>
+    FCompiledDataQuery& SetParameter(int32 Index, T Value)
+    {
+        return SetParameter(Index, FDataValue(Value));
+    }
+
+    const TSharedPtr<const FShape, ESPMode::ThreadSafe>& GetShape() const { return Shape; }
+    const TArray<FDataValue>& GetParameters() const { return Parameters; }
+
+private:
+    TSharedPtr<const FShape, ESPMode::ThreadSafe> Shape;
+    TArray<FDataValue> Parameters;
+};
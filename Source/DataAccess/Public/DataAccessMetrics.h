@@ -0,0 +1,167 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#pragma once
+
+/** Latency histograms and counters are compiled out of shipping builds unless this is set to 1 */
+#ifndef DATAACCESS_METRICS
+#define DATAACCESS_METRICS !UE_BUILD_SHIPPING
+#endif
+
+/**
+ * Data handler operations that are timed
+ */
+namespace EDataAccessOperation
+{
+    enum Type
+    {
+        Create,
+        CreateMany,
+        Update,
+        UpdateMany,
+        UpdateWhere,
+        Delete,
+        Count,
+        First,
+        Get,
+        Aggregate,
+        ExecuteQuery,
+        Num
+    };
+}
+
+/**
+ * Parts of an operation that are timed separately
+ */
+namespace EDataAccessPhase
+{
+    enum Type
+    {
+        /** Generating where clauses and statement text */
+        BuildSql,
+        /** Preparing statements on a statement cache miss */
+        Prepare,
+        /** Binding objects and where parameters */
+        Bind,
+        /** Running statements */
+        Step,
+        /** Reading result rows into objects */
+        Decode,
+        Num
+    };
+}
+
+/**
+ * Running totals
+ */
+namespace EDataAccessCounter
+{
+    enum Type
+    {
+        RowsRead,
+        RowsWritten,
+        BytesRead,
+        BytesWritten,
+        StatementCacheHits,
+        StatementCacheMisses,
+        StatementCacheEvictions,
+        Num
+    };
+}
+
+/**
+ * Lock free latency histogram with power of two microsecond buckets.  Bucket i counts samples in [2^i, 2^(i+1)) us,
+ * bucket 0 also counts samples under a microsecond.
+ */
+class DATAACCESS_API FDataAccessLatencyHistogram
+{
+public:
+    static const int32 NumBuckets = 32;
+
+    FDataAccessLatencyHistogram();
+
+    /**
+     * @param   Seconds     duration of one sample
+     */
+    void Add(double Seconds);
+
+    /**
+     * Estimate a percentile from the buckets
+     *
+     * @param   Percentile  0 to 1, e.g. 0.99
+     * @return              upper bound of the bucket holding the percentile in milliseconds, 0 without samples
+     */
+    double GetPercentileMs(float Percentile) const;
+
+    int64 GetCount() const { return Count; }
+    double GetTotalMs() const { return TotalMicroseconds / 1000.0; }
+    double GetMaxMs() const { return MaxMicroseconds / 1000.0; }
+    int64 GetBucket(int32 Index) const { return Buckets[Index]; }
+
+    void Reset();
+
+private:
+    volatile int64 Count;
+    volatile int64 TotalMicroseconds;
+    volatile int64 MaxMicroseconds;
+    volatile int64 Buckets[NumBuckets];
+};
+
+/**
+ * Process wide performance counters of the data layer.  Operations and phases are also reported to the DataAccess
+ * stat group ("stat DataAccess"), the console command DataAccess.DumpStats writes everything to the log and
+ * DataAccess.ResetStats starts over.
+ */
+class DATAACCESS_API FDataAccessMetrics
+{
+public:
+    static FDataAccessMetrics& Get();
+
+    FDataAccessLatencyHistogram& GetOperation(EDataAccessOperation::Type Operation) { return Operations[Operation]; }
+    const FDataAccessLatencyHistogram& GetOperation(EDataAccessOperation::Type Operation) const { return Operations[Operation]; }
+    FDataAccessLatencyHistogram& GetPhase(EDataAccessPhase::Type Phase) { return Phases[Phase]; }
+    const FDataAccessLatencyHistogram& GetPhase(EDataAccessPhase::Type Phase) const { return Phases[Phase]; }
+
+    void Increment(EDataAccessCounter::Type Counter, int64 Amount);
+    int64 GetCounter(EDataAccessCounter::Type Counter) const { return Counters[Counter]; }
+
+    /**
+     * Write every histogram and counter
+     *
+     * @param   Ar          device to write to, e.g. *GLog
+     */
+    void Dump(FOutputDevice& Ar) const;
+
+    void Reset();
+
+    static const TCHAR* GetOperationName(EDataAccessOperation::Type Operation);
+    static const TCHAR* GetPhaseName(EDataAccessPhase::Type Phase);
+    static const TCHAR* GetCounterName(EDataAccessCounter::Type Counter);
+
+private:
+    FDataAccessMetrics();
+
+    FDataAccessLatencyHistogram Operations[EDataAccessOperation::Num];
+    FDataAccessLatencyHistogram Phases[EDataAccessPhase::Num];
+    volatile int64 Counters[EDataAccessCounter::Num];
+};
+
+/**
+ * Adds the time between construction and destruction to a histogram
+ */
+class FDataAccessScopeTimer
+{
+public:
+    explicit FDataAccessScopeTimer(FDataAccessLatencyHistogram& Histogram)
+    : Histogram(Histogram)
+    , StartTime(FPlatformTime::Seconds())
+    {}
+
+    ~FDataAccessScopeTimer()
+    {
+        Histogram.Add(FPlatformTime::Seconds() - StartTime);
+    }
+
+private:
+    FDataAccessLatencyHistogram& Histogram;
+    double StartTime;
+};
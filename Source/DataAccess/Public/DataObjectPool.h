@@ -0,0 +1,55 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#pragma once
+
+/**
+ * Recycles UObjects of the same class between queries so reading results does not create garbage.  Objects held by
+ * the pool are kept alive for the garbage collector.
+ *
+ * Recycled objects keep the values of properties that are not saved to the database.
+ */
+class DATAACCESS_API FDataObjectPool : public FGCObject
+{
+public:
+    /**
+     * @param   MaxFreePerClass     number of released objects kept per class, objects past that are left to the garbage collector
+     */
+    FDataObjectPool(int32 MaxFreePerClass = 1024);
+    virtual ~FDataObjectPool();
+    
+    /**
+     * Get a recycled object of a class or create a new one if none are free
+     *
+     * @param   Class       class of the object
+     * @return              object of Class
+     */
+    UObject* Acquire(UClass* Class);
+    
+    /**
+     * Give an object back to the pool.  The caller must not use it afterwards.
+     */
+    void Release(UObject* Obj);
+    
+    /**
+     * Give every object in an array back to the pool and empty the array
+     */
+    void Release(TArray<UObject*>& Objs);
+    
+    /**
+     * Drop every free object
+     */
+    void Empty();
+    
+    /**
+     * @return      number of free objects of a class
+     */
+    int32 NumFree(UClass* Class) const;
+    
+    // FGCObject interface
+    virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+    // End of FGCObject interface
+    
+private:
+    int32 MaxFreePerClass;
+    TMap<UClass*, TArray<UObject*>> FreeObjects;
+};
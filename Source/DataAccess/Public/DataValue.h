@@ -0,0 +1,108 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#pragma once
+
+namespace EDataValueType
+{
+    enum Type
+    {
+        Null,
+        Integer,
+        Real,
+        Text
+    };
+}
+
+/**
+ * A typed value passed to or returned by a data handler.  Integers of every width and bools share one 64 bit slot,
+ * uint64 keeps its bit pattern the same way uint64 properties are stored.  FNames are kept as text.
+ */
+struct DATAACCESS_API FDataValue
+{
+    FDataValue()
+    : Type(EDataValueType::Null)
+    , IntegerValue(0)
+    {}
+
+    explicit FDataValue(int32 Value)
+    : Type(EDataValueType::Integer)
+    , IntegerValue(Value)
+    {}
+
+    explicit FDataValue(int64 Value)
+    : Type(EDataValueType::Integer)
+    , IntegerValue(Value)
+    {}
+
+    explicit FDataValue(uint64 Value)
+    : Type(EDataValueType::Integer)
+    , IntegerValue(static_cast<int64>(Value))
+    {}
+
+    explicit FDataValue(bool Value)
+    : Type(EDataValueType::Integer)
+    , IntegerValue(Value ? 1 : 0)
+    {}
+
+    explicit FDataValue(float Value)
+    : Type(EDataValueType::Real)
+    , RealValue(Value)
+    {}
+
+    explicit FDataValue(double Value)
+    : Type(EDataValueType::Real)
+    , RealValue(Value)
+    {}
+
+    explicit FDataValue(const FString& Value)
+    : Type(EDataValueType::Text)
+    , IntegerValue(0)
+    , TextValue(Value)
+    {}
+
+    explicit FDataValue(const TCHAR* Value)
+    : Type(EDataValueType::Text)
+    , IntegerValue(0)
+    , TextValue(Value)
+    {}
+
+    explicit FDataValue(FName Value)
+    : Type(EDataValueType::Text)
+    , IntegerValue(0)
+    , TextValue(Value.ToString())
+    {}
+
+    /**
+     * Convert text to a value of the given type, e.g. a legacy string where condition to the type of its column
+     *
+     * @param   Text        text to convert
+     * @param   AsType      type to convert to
+     */
+    static FDataValue FromString(const FString& Text, EDataValueType::Type AsType);
+
+    EDataValueType::Type GetType() const { return Type; }
+    bool IsNull() const { return Type == EDataValueType::Null; }
+
+    /** Conversions follow sqlite: reals truncate, text is parsed and null is 0 or empty */
+    int64 AsInt64() const;
+    uint64 AsUInt64() const { return static_cast<uint64>(AsInt64()); }
+    int32 AsInt32() const { return static_cast<int32>(AsInt64()); }
+    bool AsBool() const { return AsInt64() != 0; }
+    double AsDouble() const;
+    FString AsString() const;
+
+    /** Text values are returned as is, without a copy */
+    const FString& GetText() const { return TextValue; }
+
+    bool operator==(const FDataValue& Other) const;
+    bool operator!=(const FDataValue& Other) const { return !(*this == Other); }
+
+private:
+    EDataValueType::Type Type;
+    union
+    {
+        int64 IntegerValue;
+        double RealValue;
+    };
+    FString TextValue;
+};
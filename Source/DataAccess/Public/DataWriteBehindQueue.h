@@ -0,0 +1,89 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#pragma once
+
+#include "IDataHandler.h"
+
+/**
+ * Coalesces repeated updates of the same record.  Queued objects are keyed by class and Id, so updating an object many
+ * times between flushes writes it once, with whatever state it has when the flush runs.  Queued objects are kept alive
+ * for the garbage collector until they are flushed.
+ *
+ * Durability: anything queued since the last successful flush is lost if the process dies.  A flush writes every
+ * pending object in a single transaction, so after a crash the database holds either all of a flush or none of it.
+ */
+class DATAACCESS_API FDataWriteBehindQueue : public FGCObject
+{
+public:
+    /**
+     * @param   DataHandler         handler the flushes are written through.  Must not be used by another thread while flushing
+     * @param   FlushInterval       seconds between automatic flushes on the core ticker, 0 to only flush explicitly
+     */
+    FDataWriteBehindQueue(TSharedRef<IDataHandler> DataHandler, float FlushInterval = 1.f);
+
+    /**
+     * Flushes everything still pending
+     */
+    virtual ~FDataWriteBehindQueue();
+
+    /**
+     * Queue an update of an existing record.  Replaces any pending update with the same class and Id.
+     *
+     * @param   Obj     object to write, its Id must be set
+     * @return          true if queued, false otherwise
+     */
+    bool Update(UObject* const Obj);
+
+    /**
+     * Drop a pending update, e.g. before deleting the record
+     *
+     * @param   Obj     object whose pending update to drop
+     */
+    void Discard(UObject* const Obj);
+
+    /**
+     * Write every pending update.  Updates that fail stay queued for the next flush, updates of records that no
+     * longer exist are dropped.
+     *
+     * @return          true if successful, false otherwise
+     */
+    bool Flush();
+
+    /**
+     * @return          number of pending updates
+     */
+    int32 Num() const;
+
+    // FGCObject interface
+    virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+    // End of FGCObject interface
+
+private:
+    struct FPendingKey
+    {
+        UClass* Class;
+        int32 Id;
+
+        FPendingKey(UClass* Class, int32 Id)
+        : Class(Class)
+        , Id(Id)
+        {}
+
+        bool operator==(const FPendingKey& Other) const
+        {
+            return Class == Other.Class && Id == Other.Id;
+        }
+
+        friend uint32 GetTypeHash(const FPendingKey& Key)
+        {
+            return HashCombine(PointerHash(Key.Class), GetTypeHash(Key.Id));
+        }
+    };
+
+    bool Tick(float DeltaTime);
+    static int32 GetId(UObject* const Obj);
+
+    TSharedRef<IDataHandler> DataHandler;
+    TMap<FPendingKey, UObject*> Pending;
+    FDelegateHandle TickerHandle;
+};
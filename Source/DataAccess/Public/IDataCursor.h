@@ -0,0 +1,32 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+
+#pragma once
+
+/**
+ * Forward-only cursor over the results of a query.  Rows are stepped lazily so only one row is held at a time.
+ */
+class DATAACCESS_API IDataCursor
+{
+public:
+    virtual ~IDataCursor(){}
+    
+    /**
+     * Step to the next row
+     *
+     * @return      true if a row is available, false at the end of the results or on error
+     */
+    virtual bool Next() = 0;
+    
+    /**
+     * Read the current row into an object of the query's source class
+     *
+     * @param   OutObj      object to read into, can be reused between rows
+     * @return              true if successful, false otherwise
+     */
+    virtual bool Read(UObject* const OutObj) = 0;
+    
+    /**
+     * @return      true if stepping the cursor failed
+     */
+    virtual bool HasError() const = 0;
+};
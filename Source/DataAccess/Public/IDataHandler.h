@@ -2,6 +2,11 @@
 
 #pragma once
 
+#include "IDataCursor.h"
+#include "CompiledDataQuery.h"
+
+class FDataObjectPool;
+
 enum EDataHandlerOperator
 {
     GreaterThan,
@@ -12,6 +17,31 @@ enum EDataHandlerOperator
     NotEqualTo
 };
 
+enum EDataSortOrder
+{
+    Ascending,
+    Descending
+};
+
+enum EDataTransactionMode
+{
+    Deferred,
+    Immediate,
+    Exclusive
+};
+
+/**
+ * One group of an aggregate query
+ */
+struct FDataAggregateGroup
+{
+    /** Values of the GroupBy fields in the order they were added */
+    TArray<FDataValue> Keys;
+
+    /** Aggregate of the group */
+    FDataValue Value;
+};
+
 /**
  * Interface that facilities saving data.  Will utilizie Unreal's reflection to save data
  */
@@ -22,19 +52,291 @@ public:
     
     virtual IDataHandler& Source(UClass* Source) = 0;
 
+    /**
+     * Add a condition on a field.  The condition is converted to the field's type once, when the clause is added.
+     */
     virtual IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, FString Condition) = 0;
+
+    /**
+     * Add a condition on a field compared with a typed value, bound as is without formatting or parsing
+     */
+    virtual IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, const FDataValue& Value) = 0;
+
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, int32 Value) { return Where(FieldName, Operator, FDataValue(Value)); }
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, int64 Value) { return Where(FieldName, Operator, FDataValue(Value)); }
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, uint64 Value) { return Where(FieldName, Operator, FDataValue(Value)); }
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, float Value) { return Where(FieldName, Operator, FDataValue(Value)); }
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, double Value) { return Where(FieldName, Operator, FDataValue(Value)); }
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, bool Value) { return Where(FieldName, Operator, FDataValue(Value)); }
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, FName Value) { return Where(FieldName, Operator, FDataValue(Value)); }
+
+    /** String literals would otherwise convert to bool, they are treated like the FString condition */
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, const TCHAR* Condition) { return Where(FieldName, Operator, FString(Condition)); }
+    IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, const ANSICHAR* Condition) { return Where(FieldName, Operator, FString(Condition)); }
+
+    /**
+     * Only read some fields of the source class.  First, Get, OpenCursor and Iterate select and decode just these
+     * fields and the Id, every other property of the result objects keeps its value.  Ignored by other operations.
+     * Only the first 64 columns can be selected, reading a query that selects or orders by a later one fails.
+     *
+     * @param   Fields      names of the SaveToDatabase properties to read
+     */
+    virtual IDataHandler& Select(const TArray<FName>& Fields) = 0;
+
+    /**
+     * Order the results by a field.  Fields are ordered by in the order they are added.
+     */
+    virtual IDataHandler& OrderBy(FString FieldName, EDataSortOrder Order = EDataSortOrder::Ascending) = 0;
+
+    /**
+     * Return at most this many rows.  The count is bound as a parameter, so every page shares one statement.
+     */
+    virtual IDataHandler& Limit(int32 Count) = 0;
+
+    /**
+     * Skip this many rows.  Every skipped row is still stepped, prefer After for deep pages.
+     */
+    virtual IDataHandler& Offset(int32 Count) = 0;
+
+    /**
+     * Only return rows that come after a row in the OrderBy order, the next page of a keyset pagination.  Ties are
+     * broken by the Id, and the comparison can be served by an index starting with the first OrderBy field.  Call
+     * after OrderBy, fields compared with NULL match no rows.
+     *
+     * @param   Row         last row of the previous page, with at least its OrderBy fields and Id read
+     */
+    virtual IDataHandler& After(const UObject* const Row) = 0;
+
+    /**
+     * Set a field to a value in every record matched by UpdateWhere, without reading the records
+     */
+    virtual IDataHandler& Set(FString FieldName, const FDataValue& Value) = 0;
+
+    IDataHandler& Set(FString FieldName, int32 Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, int64 Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, uint64 Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, float Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, double Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, bool Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, const FString& Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, const TCHAR* Value) { return Set(FieldName, FDataValue(Value)); }
+    IDataHandler& Set(FString FieldName, const ANSICHAR* Value) { return Set(FieldName, FDataValue(FString(Value))); }
+
+    /**
+     * Add an amount to a numeric field in every record matched by UpdateWhere, computed by the database
+     */
+    virtual IDataHandler& Increment(FString FieldName, const FDataValue& Amount) = 0;
+
+    IDataHandler& Increment(FString FieldName, int32 Amount = 1) { return Increment(FieldName, FDataValue(Amount)); }
+    IDataHandler& Increment(FString FieldName, int64 Amount) { return Increment(FieldName, FDataValue(Amount)); }
+    IDataHandler& Increment(FString FieldName, float Amount) { return Increment(FieldName, FDataValue(Amount)); }
+    IDataHandler& Increment(FString FieldName, double Amount) { return Increment(FieldName, FDataValue(Amount)); }
+    IDataHandler& Decrement(FString FieldName, int32 Amount = 1) { return Increment(FieldName, FDataValue(-static_cast<int64>(Amount))); }
+    IDataHandler& Decrement(FString FieldName, int64 Amount) { return Increment(FieldName, FDataValue(-Amount)); }
+    IDataHandler& Decrement(FString FieldName, float Amount) { return Increment(FieldName, FDataValue(-Amount)); }
+    IDataHandler& Decrement(FString FieldName, double Amount) { return Increment(FieldName, FDataValue(-Amount)); }
+
+    /**
+     * Compute aggregates per distinct value of a field.  Fields are grouped by in the order they are added.  OrderBy,
+     * Limit and Offset then apply to the groups.
+     */
+    virtual IDataHandler& GroupBy(FString FieldName) = 0;
+
     virtual IDataHandler& Or() = 0;
     virtual IDataHandler& And() = 0;
     virtual IDataHandler& BeginNested() = 0;
     virtual IDataHandler& EndNested() = 0;
 
+    /**
+     * Finish the query built so far without running it.  Where values become the compiled query's parameters, Limit
+     * and Offset become defaults that can be changed after Query.  Set, Increment and Decrement keep the values they
+     * were compiled with, more can be added after Query.  After is set per run.
+     *
+     * @return      query to run with Query, invalid if no query was started
+     */
+    virtual FCompiledDataQuery Compile() = 0;
+
+    /**
+     * Start a query from a compiled one, in place of Source and Where.  Follow it with the operation to run.
+     *
+     * @param   Compiled    query from Compile with its parameters set
+     */
+    virtual IDataHandler& Query(const FCompiledDataQuery& Compiled) = 0;
+
     virtual bool Create(UObject* const Obj) = 0;
+
+    /**
+     * Create every object in one transaction.  Ids and timestamps are written back to each object.
+     */
+    virtual bool CreateMany(const TArray<UObject*>& Objs) = 0;
+
     virtual bool Update(UObject* const Obj) = 0;
+
+    /**
+     * Update every object by its Id in one transaction.  Timestamps are written back to each object.  Fails and
+     * rolls back if any object has no record.
+     */
+    virtual bool UpdateMany(const TArray<UObject*>& Objs) = 0;
+
+    /**
+     * Update every object by its Id in one transaction, skipping objects whose record no longer exists
+     *
+     * @param   Objs            objects to update
+     * @param   OutMissing      emptied and filled with the objects that matched no record
+     * @return                  true if every existing record was written, false on errors
+     */
+    virtual bool UpdateMany(const TArray<UObject*>& Objs, TArray<UObject*>& OutMissing) = 0;
+
+    /**
+     * Apply the Set, Increment and Decrement calls of the query to every record it matches in one statement
+     *
+     * @param   OutAffected     number of records changed
+     * @return                  true if the statement ran successfully, including when no records matched
+     */
+    virtual bool UpdateWhere(int32& OutAffected) = 0;
+
     virtual bool Delete() = 0;
+
+    /**
+     * Delete every record the query matches
+     *
+     * @param   OutAffected     number of records deleted
+     * @return                  true if the statement ran successfully, including when no records matched
+     */
+    virtual bool Delete(int32& OutAffected) = 0;
     virtual bool Count(int32& OutCount) = 0;
+
+    /**
+     * Compute an aggregate of a field over the matching rows in the database without reading any objects.  Sum, Min
+     * and Max keep the field's type, Avg is real.  The value is null if no rows match.
+     *
+     * @param   FieldName   field to aggregate
+     * @param   OutValue    aggregate of every matching row
+     * @return              true if successful, false otherwise or if the query has a GroupBy
+     */
+    virtual bool Sum(FString FieldName, FDataValue& OutValue) = 0;
+    virtual bool Min(FString FieldName, FDataValue& OutValue) = 0;
+    virtual bool Max(FString FieldName, FDataValue& OutValue) = 0;
+    virtual bool Avg(FString FieldName, FDataValue& OutValue) = 0;
+
+    /**
+     * Compute an aggregate of a field per group of the GroupBy fields
+     *
+     * @param   FieldName   field to aggregate
+     * @param   OutGroups   emptied and filled with one entry per group, a single group without keys if there is no GroupBy
+     * @return              true if successful, false otherwise
+     */
+    virtual bool Sum(FString FieldName, TArray<FDataAggregateGroup>& OutGroups) = 0;
+    virtual bool Min(FString FieldName, TArray<FDataAggregateGroup>& OutGroups) = 0;
+    virtual bool Max(FString FieldName, TArray<FDataAggregateGroup>& OutGroups) = 0;
+    virtual bool Avg(FString FieldName, TArray<FDataAggregateGroup>& OutGroups) = 0;
     virtual bool First(UObject* const OutObj) = 0;
     virtual bool Get(TArray<UObject*>& OutObjs) = 0;
 
+    /**
+     * Run the query and create an object of the source class for every result row
+     *
+     * @param   OutObjs         emptied and filled with one object per row
+     * @param   ObjectPool      pool to take result objects from.  If nullptr new objects are created
+     * @return                  true if the query ran successfully, including when it returned no rows
+     */
+    virtual bool Get(TArray<UObject*>& OutObjs, FDataObjectPool* ObjectPool) = 0;
+
+    /**
+     * Run the query and return a forward-only cursor over its results
+     *
+     * @return      cursor or an invalid pointer if the query could not be run
+     */
+    virtual TSharedPtr<IDataCursor> OpenCursor() = 0;
+
+    /**
+     * Run the query and hand every result row to a callback as it is stepped
+     *
+     * @param   Callback    called per row, return false to stop iterating
+     * @param   ReuseObj    object every row is read into.  If nullptr a new object of the source class is created per row
+     * @return              true if the query ran successfully, including when it returned no rows
+     */
+    virtual bool Iterate(TFunctionRef<bool(UObject*)> Callback, UObject* const ReuseObj = nullptr) = 0;
+
+    /**
+     * Create the source class's table, timestamp triggers and declared indexes if they do not exist.  Columns missing
+     * from an existing table are added and columns declared with a different type are reported.
+     *
+     * @return      true if the table matches the class, false if it could not be brought up to date or a column is declared with a different type
+     */
+    virtual bool EnsureTable() = 0;
+
 	virtual bool ExecuteQuery(FString Query, TArray< TSharedPtr<class FJsonValue> >& JsonArray) = 0;
-    
+
+    /**
+     * Begin a transaction.  Calling this while a transaction is open starts a nested savepoint instead.
+     *
+     * @param   Mode        locking mode of the outermost transaction, ignored for nested savepoints
+     * @return              true if successful, false otherwise
+     */
+    virtual bool BeginTransaction(EDataTransactionMode Mode = EDataTransactionMode::Deferred) = 0;
+
+    /**
+     * Commit the innermost open transaction or savepoint
+     */
+    virtual bool Commit() = 0;
+
+    /**
+     * Roll back the innermost open transaction or savepoint
+     */
+    virtual bool Rollback() = 0;
+};
+
+/**
+ * Keeps a transaction open for the lifetime of the scope.  Rolls back on destruction unless Commit was called.
+ */
+class FDataTransactionScope
+{
+public:
+    FDataTransactionScope(IDataHandler& DataHandler, EDataTransactionMode Mode = EDataTransactionMode::Deferred)
+    : DataHandler(DataHandler)
+    , bActive(DataHandler.BeginTransaction(Mode))
+    {}
+
+    ~FDataTransactionScope()
+    {
+        if(bActive)
+        {
+            DataHandler.Rollback();
+        }
+    }
+
+    /**
+     * Commit the scope's transaction.  The scope does nothing on destruction afterwards, unless the commit failed
+     * in which case the transaction is still rolled back.
+     */
+    bool Commit()
+    {
+        if(!bActive)
+        {
+            return false;
+        }
+
+        bool bCommitted = DataHandler.Commit();
+        if(bCommitted)
+        {
+            bActive = false;
+        }
+        return bCommitted;
+    }
+
+    /**
+     * @return  true if the transaction was started and has not been committed yet
+     */
+    bool IsActive() const
+    {
+        return bActive;
+    }
+
+private:
+    FDataTransactionScope(const FDataTransactionScope&);
+    FDataTransactionScope& operator=(const FDataTransactionScope&);
+
+    IDataHandler& DataHandler;
+    bool bActive;
 };
\ No newline at end of file
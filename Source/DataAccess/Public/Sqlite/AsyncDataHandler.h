@@ -0,0 +1,136 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+#include "Async/Future.h"
+#include "IDataHandler.h"
+
+class SqliteDataResource;
+
+/**
+ * Runs data handler commands on a dedicated database thread.  The thread owns its own SqliteDataResource and
+ * SqliteDataHandler, commands are fed to it through a lock free multi producer queue and results are handed back
+ * through futures or callbacks on the game thread.
+ *
+ * Objects passed with a command are kept alive until the command completes and must not be touched by other
+ * threads until then.  Commands run on the database thread, so they must not create UObjects; read into objects
+ * created on the game thread instead (e.g. Iterate with a reuse object, or First).
+ *
+ * The convenience commands never touch the passed objects off the game thread.  Their persisted properties are copied
+ * into private objects when the command is queued, the database thread only works on those and the results are copied
+ * back on the game thread before the future is set.  Block on Flush rather than on their futures on the game thread.
+ */
+class DATAACCESS_API FAsyncDataHandler : public FRunnable, public FGCObject
+{
+public:
+    /** A unit of work run against the database thread's handler, returns its success */
+    typedef TFunction<bool(IDataHandler&)> FDataCommand;
+
+    /** Called on the game thread with the success of a command */
+    typedef TFunction<void(bool)> FDataCommandCallback;
+
+    /**
+     * Start the database thread.  The database is opened on that thread.
+     *
+     * @param   DatabaseFileLocation        path to the sqlite database
+     */
+    FAsyncDataHandler(FString DatabaseFileLocation);
+
+    /**
+     * Runs every queued command, then stops the database thread and releases the database
+     */
+    virtual ~FAsyncDataHandler();
+
+    /**
+     * Queue a command
+     *
+     * @param   Command     work to run on the database thread
+     * @param   Objects     objects the command reads or writes, kept alive until it completes
+     * @return              future set to the command's success once it ran
+     */
+    TFuture<bool> Enqueue(FDataCommand Command, const TArray<UObject*>& Objects = TArray<UObject*>());
+
+    /**
+     * Queue a command and get called back on the game thread when it completes
+     *
+     * @param   Command     work to run on the database thread
+     * @param   Callback    called on the game thread with the command's success
+     * @param   Objects     objects the command reads or writes, kept alive until the callback ran
+     */
+    void Enqueue(FDataCommand Command, FDataCommandCallback Callback, const TArray<UObject*>& Objects = TArray<UObject*>());
+
+    /**
+     * Convenience commands.  Updates, reads and deletes match the object's Id.  Generated Ids and timestamps, and the
+     * values read by First, are copied into the passed objects on the game thread when the command succeeds.
+     */
+    TFuture<bool> Create(UObject* Obj);
+    TFuture<bool> CreateMany(const TArray<UObject*>& Objs);
+    TFuture<bool> Update(UObject* Obj);
+    TFuture<bool> UpdateMany(const TArray<UObject*>& Objs);
+    TFuture<bool> First(UObject* OutObj, int32 Id);
+    TFuture<bool> Delete(UObject* Obj);
+
+    /**
+     * Block until every command queued before this call has run.  On the game thread their results are copied into
+     * their objects and their callbacks run before this returns.
+     */
+    void Flush();
+
+    // FRunnable interface
+    virtual uint32 Run() override;
+    virtual void Stop() override;
+    // End of FRunnable interface
+
+    // FGCObject interface
+    virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+    // End of FGCObject interface
+
+private:
+    /** Copies the results of a successful command into the caller's objects, run on the game thread */
+    typedef TFunction<void()> FDataCommandApply;
+
+    struct FQueuedCommand
+    {
+        FDataCommand Command;
+        FDataCommandApply Apply;
+        FDataCommandCallback Callback;
+        TPromise<bool> Promise;
+        TArray<UObject*> Objects;
+    };
+
+    /** Objects referenced by queued commands with their reference counts.  Shared with callbacks that outlive the handler. */
+    struct FInFlightObjects
+    {
+        TMap<UObject*, int32> Counts;
+        FCriticalSection Lock;
+
+        void Add(const TArray<UObject*>& Objects);
+        void Remove(const TArray<UObject*>& Objects);
+    };
+
+    /**
+     * Queue a command whose results are copied into objects on the game thread
+     *
+     * @param   Command     work to run on the database thread
+     * @param   Apply       called on the game thread before the future is set, if the command succeeded
+     * @param   Objects     objects the command or Apply touch, kept alive until Apply ran
+     * @return              future set to the command's success once Apply ran
+     */
+    TFuture<bool> EnqueueWithResults(FDataCommand Command, FDataCommandApply Apply, const TArray<UObject*>& Objects);
+
+    void QueueCommand(FQueuedCommand* QueuedCommand);
+    void ProcessCommands();
+    void CompleteCommand(FQueuedCommand* QueuedCommand, bool bSuccess);
+
+    FString DatabaseFileLocation;
+
+    /** Only touched by the database thread */
+    TSharedPtr<SqliteDataResource> DataResource;
+    TSharedPtr<IDataHandler> DataHandler;
+
+    TQueue<FQueuedCommand*, EQueueMode::Mpsc> Commands;
+    FEvent* WorkEvent;
+    FRunnableThread* Thread;
+    FThreadSafeCounter StopCounter;
+
+    TSharedRef<FInFlightObjects, ESPMode::ThreadSafe> InFlightObjects;
+};
@@ -0,0 +1,89 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+typedef struct sqlite3 sqlite3;
+
+/**
+ * Pragmas applied to a sqlite connection when it is acquired.  Empty strings and zero or negative sizes
+ * (-1 for MmapSize) leave sqlite's default in place.
+ */
+struct DATAACCESS_API FSqliteConnectionProfile
+{
+    /** journal_mode: DELETE, TRUNCATE, PERSIST, MEMORY, WAL or OFF.  Persists in the database file for WAL */
+    FString JournalMode;
+
+    /** synchronous: OFF, NORMAL, FULL or EXTRA */
+    FString Synchronous;
+
+    /** cache_size: pages if positive, KiB if negative, 0 to leave the default */
+    int32 CacheSize;
+
+    /** mmap_size in bytes, -1 to leave the default */
+    int64 MmapSize;
+
+    /** temp_store: DEFAULT, FILE or MEMORY */
+    FString TempStore;
+
+    /** page_size in bytes.  Only takes effect on a database without tables or before a VACUUM, and never in WAL mode */
+    int32 PageSize;
+
+    FSqliteConnectionProfile()
+    : CacheSize(0)
+    , MmapSize(-1)
+    , PageSize(0)
+    {}
+
+    /**
+     * Apply the profile to an open connection
+     *
+     * @param   Database    connection to apply to
+     * @return              true if every pragma ran, false otherwise
+     */
+    bool Apply(sqlite3* Database) const;
+
+    /**
+     * Register a named profile, replacing one with the same name
+     *
+     * @param   Name        profile name
+     * @param   Profile     pragmas to apply
+     */
+    static void Register(FName Name, const FSqliteConnectionProfile& Profile);
+
+    /**
+     * Find a registered profile.  "Durable", "FastSaveGame" and "ReadMostly" are always registered.
+     *
+     * @param   Name        profile name
+     * @param   OutProfile  found profile
+     * @return              true if the profile exists, false otherwise
+     */
+    static bool Find(FName Name, FSqliteConnectionProfile& OutProfile);
+};
+
+/**
+ * Values a connection actually ended up with, read back after a profile was applied
+ */
+struct DATAACCESS_API FSqliteConnectionSettings
+{
+    FString JournalMode;
+    FString Synchronous;
+    int32 CacheSize;
+    int64 MmapSize;
+    FString TempStore;
+    int32 PageSize;
+
+    FSqliteConnectionSettings()
+    : CacheSize(0)
+    , MmapSize(0)
+    , PageSize(0)
+    {}
+
+    /**
+     * Read the settings of an open connection
+     *
+     * @param   Database    connection to read from
+     * @return              true if every pragma could be read, false otherwise
+     */
+    bool Read(sqlite3* Database);
+
+    FString ToString() const;
+};
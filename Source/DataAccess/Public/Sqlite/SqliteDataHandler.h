@@ -2,9 +2,13 @@
 #pragma once
 
 #include "IDataHandler.h"
+#include "SqliteStatementCache.h"
 
 // forward declaration
 class SqliteDataResource;
+class FSqliteClassSchema;
+class FSqliteScratchArena;
+typedef struct sqlite3 sqlite3;
 typedef struct sqlite3_stmt sqlite3_stmt;
 
 /**
@@ -24,20 +28,56 @@ public:
     // IDataHandler interface
     virtual IDataHandler& Source(UClass* Source);
 
+    using IDataHandler::Where;
     virtual IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, FString Condition);
+    virtual IDataHandler& Where(FString FieldName, EDataHandlerOperator Operator, const FDataValue& Value);
+    virtual IDataHandler& Select(const TArray<FName>& Fields);
+    virtual IDataHandler& OrderBy(FString FieldName, EDataSortOrder Order = EDataSortOrder::Ascending);
+    virtual IDataHandler& Limit(int32 Count);
+    virtual IDataHandler& Offset(int32 Count);
+    virtual IDataHandler& After(const UObject* const Row);
+    virtual IDataHandler& GroupBy(FString FieldName);
+    using IDataHandler::Set;
+    using IDataHandler::Increment;
+    virtual IDataHandler& Set(FString FieldName, const FDataValue& Value);
+    virtual IDataHandler& Increment(FString FieldName, const FDataValue& Amount);
     virtual IDataHandler& Or();
     virtual IDataHandler& And();
     virtual IDataHandler& BeginNested();
     virtual IDataHandler& EndNested();
+    virtual FCompiledDataQuery Compile();
+    virtual IDataHandler& Query(const FCompiledDataQuery& Compiled);
 
     virtual bool Create(UObject* const Obj);
+    virtual bool CreateMany(const TArray<UObject*>& Objs);
     virtual bool Update(UObject* const Obj);
+    virtual bool UpdateMany(const TArray<UObject*>& Objs);
+    virtual bool UpdateMany(const TArray<UObject*>& Objs, TArray<UObject*>& OutMissing);
+    virtual bool UpdateWhere(int32& OutAffected);
     virtual bool Delete();
+    virtual bool Delete(int32& OutAffected);
     virtual bool Count(int32& OutCount);
+    virtual bool Sum(FString FieldName, FDataValue& OutValue);
+    virtual bool Min(FString FieldName, FDataValue& OutValue);
+    virtual bool Max(FString FieldName, FDataValue& OutValue);
+    virtual bool Avg(FString FieldName, FDataValue& OutValue);
+    virtual bool Sum(FString FieldName, TArray<FDataAggregateGroup>& OutGroups);
+    virtual bool Min(FString FieldName, TArray<FDataAggregateGroup>& OutGroups);
+    virtual bool Max(FString FieldName, TArray<FDataAggregateGroup>& OutGroups);
+    virtual bool Avg(FString FieldName, TArray<FDataAggregateGroup>& OutGroups);
     virtual bool First(UObject* const OutObj);
     virtual bool Get(TArray<UObject*>& OutObjs);
+    virtual bool Get(TArray<UObject*>& OutObjs, FDataObjectPool* ObjectPool);
+    virtual TSharedPtr<IDataCursor> OpenCursor();
+    virtual bool Iterate(TFunctionRef<bool(UObject*)> Callback, UObject* const ReuseObj = nullptr);
+
+    virtual bool EnsureTable();
 
 	virtual bool ExecuteQuery(FString Query, TArray< TSharedPtr<class FJsonValue> >& JsonArray);
+
+    virtual bool BeginTransaction(EDataTransactionMode Mode = EDataTransactionMode::Deferred);
+    virtual bool Commit();
+    virtual bool Rollback();
     // End of IDataHandler interface
 
 private:
@@ -45,28 +85,254 @@ private:
     
     bool QueryStarted;
     UClass* SourceClass;
+    TSharedPtr<const FSqliteClassSchema, ESPMode::ThreadSafe> SourceSchema;
     TArray<FString> QueryParts;
-    TArray<TPair<UClass*, FString>> QueryParameters;
+    TArray<FDataValue> QueryParameters;
+
+    /** Columns chosen with Select, one bit per entry of the schema's Columns.  0 for every column */
+    uint64 SelectMask;
+
+    /** Select or OrderBy needed a column the mask cannot hold, reading fails instead of writing unselected fields */
+    bool bSelectFailed;
+
+    /** OrderBy field names, each followed by ASC or DESC */
+    TArray<FString> OrderParts;
+
+    /** GroupBy field names */
+    TArray<FString> GroupParts;
+
+    /** Assignments of Set and Increment, e.g. "TestInt = TestInt + ?", and the values bound to them before the where parameters */
+    TArray<FString> SetParts;
+    TArray<FDataValue> SetParameters;
+
+    /** Row limit and offset, INDEX_NONE and 0 if not set */
+    int32 QueryLimit;
+    int32 QueryOffset;
+
+    /** Order the keyset of After compares in, the OrderBy parts with the Id appended as a tie breaker */
+    TArray<FString> KeysetParts;
+
+    /** Values of the After row, one per field of KeysetParts.  Bound after the where parameters */
+    TArray<FDataValue> KeysetValues;
+
+    /** Shape of the compiled query being run, used in place of QueryParts */
+    TSharedPtr<const FCompiledDataQuery::FShape, ESPMode::ThreadSafe> CompiledShape;
+
+    /** Number of open transactions and savepoints started through this handler */
+    int32 TransactionDepth;
+
+    /** True if the outermost level was started with BEGIN, false if it is a savepoint inside someone else's transaction */
+    bool bOwnsTransaction;
+
+    /** Unique per handler, so handlers nesting savepoints on the same connection never release each other's */
+    const int32 SavepointPrefix;
+
+    /** UTF-8 text bound or prepared by the current query, reset by ClearQuery */
+    TUniquePtr<FSqliteScratchArena> Scratch;
     
     void ClearQuery();
     FString GenerateWhereClause();
 
     /**
+     * Get the parts of the current query, built with Where or from a compiled query
+     */
+    const TArray<FString>& GetQueryParts() const;
+
+    /**
+     * Get the OrderBy parts of the current query, built with OrderBy or from a compiled query
+     */
+    const TArray<FString>& GetOrderParts() const;
+
+    /**
+     * Get the GroupBy parts of the current query, built with GroupBy or from a compiled query
+     */
+    const TArray<FString>& GetGroupParts() const;
+
+    /**
+     * Get the OrderBy parts followed by Id ASC unless the Id is already ordered, so ties always sort the same way
+     *
+     * @param   OutParts    field names each followed by ASC or DESC, empty if the query is not ordered
+     */
+    void GetTotalOrderParts(TArray<FString>& OutParts) const;
+
+    /**
+     * Build the ORDER BY, LIMIT and OFFSET of a select
+     *
+     * @param   bBreakTiesById  order by the Id after the OrderBy fields, false for grouped rows which have no Id
+     * @return                  "ORDER BY TestInt DESC,Id ASC LIMIT ? OFFSET ?", empty if the select is not ordered or limited
+     */
+    FString GenerateOrderClause(bool bBreakTiesById = true) const;
+
+    /**
+     * Get a prepared statement for the current source from the connection's statement cache, preparing it on a miss.
+     * Selects and counts outside of a transaction are prepared on the calling thread's reader connection when the resource has readers
+     *
+     * @param   StatementType       kind of statement to get
+     * @param   WhereClause         generated WHERE clause, part of the statement's shape
+     * @param   ColumnMask          columns an update sets, one bit per entry of the schema's WritableColumns, or columns a select
+     *                              returns, one bit per entry of the schema's Columns.  0 for every column
+     * @param   OrderClause         generated GROUP BY, ORDER BY, LIMIT and OFFSET of a select
+     * @param   ColumnList          result columns of an aggregate or assignments of a set based update
+     * @return                      statement ready to be bound or nullptr if it could not be prepared
+     */
+    sqlite3_stmt* AcquireStatement(ESqliteStatementType::Type StatementType, const FString& WhereClause, uint64 ColumnMask = 0, const FString& OrderClause = FString(), const FString& ColumnList = FString());
+
+    /**
+     * Hand a statement from AcquireStatement back to the statement cache
+     */
+    void ReleaseStatement(sqlite3_stmt* const SqliteStatement);
+
+    /**
+     * Get the connection reads are routed to: the calling thread's reader, or the writer inside of a transaction
+     */
+    sqlite3* GetReadDatabase() const;
+
+    /**
+     * Build the sql text for a statement of the current source
+     */
+    FString GenerateStatementSql(ESqliteStatementType::Type StatementType, const FString& WhereClause, uint64 ColumnMask, const FString& OrderClause, const FString& ColumnList) const;
+
+    /**
+     * Run an aggregate of a field over the current query, grouped by its GroupBy fields
+     *
+     * @param   Function        sql aggregate function, e.g. SUM
+     * @param   FieldName       field to aggregate
+     * @param   OutGroups       emptied and filled with one entry per group
+     * @return                  true if successful, false otherwise
+     */
+    bool Aggregate(const TCHAR* Function, const FString& FieldName, TArray<FDataAggregateGroup>& OutGroups);
+
+    /**
+     * Run an aggregate of a field over the current query, which must not be grouped
+     */
+    bool AggregateValue(const TCHAR* Function, const FString& FieldName, FDataValue& OutValue);
+
+    /**
+     * Acquire the statements for an insert or update of the source class.  When the linked sqlite supports RETURNING
+     * the write statement reports the generated columns and no timestamp statement is acquired.
+     *
+     * @param   StatementType           Insert or Update
+     * @param   WhereClause             where clause of an update
+     * @param   OutWriteStatement       insert or update statement
+     * @param   OutTimestampStatement   select reading back the generated columns or nullptr when RETURNING is used
+     * @param   ColumnMask              columns an update sets, 0 for every column
+     * @return                          true if successful, false otherwise
+     */
+    bool AcquireWriteStatements(ESqliteStatementType::Type StatementType, const FString& WhereClause, sqlite3_stmt*& OutWriteStatement, sqlite3_stmt*& OutTimestampStatement, uint64 ColumnMask = 0);
+
+    /**
+     * Insert one object with an already acquired insert statement and read back its Id and timestamps
+     *
+     * @param   Obj                 object to insert
+     * @param   InsertStatement     insert statement for the source class
+     * @param   TimestampStatement  timestamp select for the source class, nullptr if InsertStatement uses RETURNING
+     * @return                      true if successful, false otherwise
+     */
+    bool InsertObject(UObject* const Obj, sqlite3_stmt* const InsertStatement, sqlite3_stmt* const TimestampStatement);
+
+    /**
+     * Update one object with an already acquired update statement and read back its update timestamp
+     *
+     * @param   Obj                 object to update
+     * @param   UpdateStatement     update statement for the source class
+     * @param   TimestampStatement  timestamp select with the same where clause as UpdateStatement, nullptr if UpdateStatement uses RETURNING
+     * @param   bUseWhereClause     bind the built where clause if true, otherwise bind the object's Id
+     * @param   OutUpdatedRows      number of records the statement changed
+     * @param   ColumnMask          columns UpdateStatement sets, 0 for every column
+     * @return                      true if the statement ran successfully, including when it matched no records
+     */
+    bool UpdateObject(UObject* const Obj, sqlite3_stmt* const UpdateStatement, sqlite3_stmt* const TimestampStatement, bool bUseWhereClause, int32& OutUpdatedRows, uint64 ColumnMask = 0);
+
+    /**
+     * Update objects by their Id in one transaction
      *
+     * @param   Objs                objects to update
+     * @param   OutMissing          filled with the objects that matched no record.  If nullptr a missing record fails the batch
+     * @return                      true if successful, false otherwise
+     */
+    bool UpdateObjects(const TArray<UObject*>& Objs, TArray<UObject*>* OutMissing);
+
+    /**
+     * Get the Id the where clause matches if it is exactly "Id = <value>"
+     *
+     * @param   OutId       matched Id
+     * @return              true if the where clause only matches by Id, false otherwise
+     */
+    bool GetWhereId(int32& OutId) const;
+
+    /**
+     * Work out which columns of a tracked object differ from its last persisted values
+     *
+     * @param   Obj             object about to be updated by Id
+     * @param   OutColumnMask   columns to set, one bit per entry of the schema's WritableColumns.  0 for every column
+     * @return                  false if the object is unchanged and the update can be skipped, true otherwise
+     */
+    bool GetChangedColumns(UObject* const Obj, uint64& OutColumnMask) const;
+
+    /**
+     * Forget the snapshots of every record the current where clause may match, after they were changed in the database
+     */
+    void ForgetSnapshots();
+
+    /**
+     * Add an assignment of a set based update
+     *
+     * @param   FieldName       field to assign
+     * @param   Assignment      assignment of the field with one parameter, e.g. "TestInt = ?"
+     * @param   Value           value bound to the assignment
+     */
+    void AddSetPart(const FString& FieldName, const FString& Assignment, const FDataValue& Value);
+
+    /**
+     * Remember an object's values as persisted when change tracking is enabled
+     */
+    void StoreSnapshot(UObject* const Obj);
+
+    /**
+     * Execute a statement that does not return rows
+     */
+    bool ExecuteStatement(const TCHAR* Sql);
+
+    /**
+     * @param   Depth   transaction depth the savepoint was started at
+     * @return          name of this handler's savepoint at that depth
+     */
+    FString GetSavepointName(int32 Depth) const;
+
+    /**
+     * Bind a query value.  Text is converted into the scratch arena and bound in place unless bTransient is set.
+     *
+     * @return      sqlite result code
+     */
+    int32 BindValueToStatement(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex, const FDataValue& Value, bool bTransient);
+
+    /**
+     * Bind the where clause parameters, followed by the After keyset values.  Text is converted into the scratch arena and bound in place.
+     *
+     * @param   SqliteStatement     statement to bind to
+     * @param   ParameterIndex      1 based index of the first where parameter
+     * @param   bTransient          let sqlite copy bound text, for statements that outlive the current query such as cursors
+     * @return                      true if successful, false otherwise
+     */
+    bool BindWhereToStatement(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex = 1, bool bTransient = false);
+
+    /**
+     * Bind the parameters of a select: the where clause, then the limit and offset of GenerateOrderClause
      */
-    bool BindWhereToStatement(sqlite3_stmt* const SqliteStatement, int32 ParameterIndex = 1);
+    bool BindSelectToStatement(sqlite3_stmt* const SqliteStatement, bool bTransient = false);
     
     /**
      * Bind parameters to the passed in sqlite statement
      *
      * @param   Obj                 object that contains the data we want to bind
      * @param   SqliteStatement     sqlite statement to bind to
+     * @param   ColumnMask          columns to bind, one bit per entry of the schema's WritableColumns.  0 for every column
      * @return                      true if successful, false otherwise
      */
-    bool BindObjectToStatement(UObject* const Obj, sqlite3_stmt* const SqliteStatement);
+    bool BindObjectToStatement(UObject* const Obj, sqlite3_stmt* const SqliteStatement, uint64 ColumnMask = 0);
     
     /**
-     * Bind result to UObject
+     * Bind result to UObject.  Only the columns chosen with Select are read.
      *
      * @param SqliteStatement       statement to bind from
      * @param Obj                   object to bind to
@@ -2,23 +2,176 @@
 #pragma once
 
 #include "IDataResource.h"
+#include "SqliteStatementCache.h"
+#include "SqliteConnectionProfile.h"
+#include "SqliteSnapshotStore.h"
+#include "SqliteQueryPlanAdvisor.h"
 
 typedef struct sqlite3 sqlite3;
 
+/**
+ * A read only connection of a SqliteDataResource's reader pool with its own statement cache
+ */
+struct FSqliteReaderConnection
+{
+    sqlite3* Database;
+    SqliteStatementCache StatementCache;
+
+    FSqliteReaderConnection(int32 StatementCacheCapacity)
+    : Database(nullptr)
+    , StatementCache(StatementCacheCapacity)
+    {}
+};
+
 /**
  * Implementation of IDataResource for Sqlite
+ *
+ * With a reader count above zero the database is switched to WAL mode and the resource opens one writer plus that many
+ * read only connections.  Each thread reading through the resource is pinned to one reader, so reads from different
+ * threads run in parallel and never wait on the writer.  Handlers are not thread safe, use one handler per thread.
  */
 class DATAACCESS_API SqliteDataResource : public IDataResource<sqlite3>
 {
 public:
-    SqliteDataResource(FString DatabaseFileLocation);
+    /**
+     * @param   DatabaseFileLocation        path to the sqlite database
+     * @param   StatementCacheCapacity      number of prepared statements to keep alive per connection
+     * @param   ReaderCount                 number of read only connections to open in WAL mode, 0 to read through the writer
+     */
+    SqliteDataResource(FString DatabaseFileLocation, int32 StatementCacheCapacity = 64, int32 ReaderCount = 0);
     virtual ~SqliteDataResource();
     
     virtual bool Acquire();
     virtual bool Release();
     virtual sqlite3* Get() const;
     
+    /**
+     * Set the pragmas applied by the next Acquire.  The writer gets the whole profile, readers only the
+     * per-connection settings.  A reader pool always puts the database in WAL mode.
+     *
+     * @param   Profile     pragmas to apply
+     */
+    void SetConnectionProfile(const FSqliteConnectionProfile& Profile);
+
+    /**
+     * Set the pragmas applied by the next Acquire from a registered profile
+     *
+     * @param   ProfileName     name the profile was registered with, e.g. "Durable", "FastSaveGame" or "ReadMostly"
+     * @return                  true if the profile exists, false otherwise
+     */
+    bool SetConnectionProfile(FName ProfileName);
+
+    /**
+     * @return  settings the writer connection ended up with after the last Acquire
+     */
+    const FSqliteConnectionSettings& GetEffectiveSettings() const;
+
+    /**
+     * Get the prepared statement cache of the writer connection
+     */
+    SqliteStatementCache& GetStatementCache();
+
+    /**
+     * Get the prepared statement cache of the writer or of one of the readers.  The cache is freed by Release, use
+     * ReturnStatement to return statements from other threads.
+     *
+     * @param   Connection      connection owned by this resource
+     */
+    SqliteStatementCache& GetStatementCache(sqlite3* Connection);
+
+    /**
+     * Return a checked out statement to the cache of its connection.  Statements outliving Release are finalized.
+     *
+     * @param   SqliteStatement     statement checked out from one of this resource's caches
+     */
+    void ReturnStatement(sqlite3_stmt* SqliteStatement);
+
+    /**
+     * Get the read only connection pinned to the calling thread
+     *
+     * @return  reader connection or nullptr if the resource has no readers
+     */
+    FSqliteReaderConnection* GetReader();
+
+    /**
+     * @return  number of open read only connections
+     */
+    int32 GetReaderCount() const;
+    
+    /**
+     * Keep the last persisted values of records read or written through this resource so updates matched by Id only
+     * write the columns that changed and are skipped when nothing did.  Only enable this when every write to the
+     * database goes through this resource.
+     *
+     * @param   bEnabled    true to track changes, false to stop and forget every snapshot
+     */
+    void SetChangeTracking(bool bEnabled);
+
+    /**
+     * @return  true if change tracking is enabled
+     */
+    bool IsChangeTracking() const;
+
+    /**
+     * Serve First lookups matched exactly by Id from the last persisted values of records read or written through
+     * this resource, copying them into the passed object instead of querying.  Creates, updates and deletes keep the
+     * map coherent.  Only enable this when every write to the database goes through this resource.
+     *
+     * @param   bEnabled    true to serve Id lookups from memory, false to stop
+     */
+    void SetIdentityMap(bool bEnabled);
+
+    /**
+     * @return  true if Id lookups are served from memory
+     */
+    bool IsIdentityMap() const;
+
+    /**
+     * @return  true if the last persisted values of records are kept, for change tracking or the identity map
+     */
+    bool UsesSnapshots() const;
+
+    /**
+     * Get the last persisted values of tracked records.  Use SetCapacity on it to bound how many records are kept.
+     */
+    SqliteSnapshotStore& GetSnapshots();
+    
+    /**
+     * Get the query plan advisor shared by every handler of this resource.  Enable it while profiling to have each
+     * distinct where clause explained, full scans of large tables logged and index DDL recommended.
+     */
+    SqliteQueryPlanAdvisor& GetQueryPlanAdvisor();
+    
+    /**
+     * @return  true if the linked sqlite supports INSERT/UPDATE ... RETURNING (3.35.0 and up)
+     */
+    bool SupportsReturning() const;
+    
 private:
+    /**
+     * Switch the writer to WAL mode and open the readers
+     */
+    bool AcquireReaders();
+
     FString     DatabaseFileLocation;
     sqlite3*    DatabaseResource;
+    SqliteStatementCache StatementCache;
+
+    SqliteSnapshotStore Snapshots;
+    bool bChangeTracking;
+    bool bIdentityMap;
+
+    SqliteQueryPlanAdvisor QueryPlanAdvisor;
+
+    FSqliteConnectionProfile ConnectionProfile;
+    FSqliteConnectionSettings EffectiveSettings;
+
+    int32 StatementCacheCapacity;
+    int32 ReaderCount;
+    TIndirectArray<FSqliteReaderConnection> Readers;
+
+    /** Thread id to index into Readers, assigned round robin on first read */
+    TMap<uint32, int32> ReaderAssignments;
+    int32 NextReader;
+    FCriticalSection ReaderLock;
 };
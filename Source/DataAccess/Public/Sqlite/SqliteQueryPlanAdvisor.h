@@ -0,0 +1,101 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+typedef struct sqlite3 sqlite3;
+
+/**
+ * Debug aid that records every WHERE shape the data handlers run, explains each distinct shape once with
+ * EXPLAIN QUERY PLAN and recommends indexes for shapes that scan large tables.  Disabled by default.
+ */
+class DATAACCESS_API SqliteQueryPlanAdvisor
+{
+public:
+    /** What was learned about one WHERE shape of a table */
+    struct FShape
+    {
+        FString TableName;
+        FString WhereClause;
+
+        /** Number of statements run with this shape */
+        uint64 Uses;
+
+        /** EXPLAIN QUERY PLAN detail rows */
+        TArray<FString> Plan;
+
+        /** True if the plan scans the whole table */
+        bool bFullScan;
+
+        /** Rows in the table when the shape was explained */
+        int64 TableRows;
+
+        /** Index DDL that would avoid the scan, empty if none is needed */
+        FString RecommendedIndex;
+    };
+
+    SqliteQueryPlanAdvisor();
+
+    /**
+     * @param   bEnabled        true to record and explain query shapes
+     */
+    void SetEnabled(bool bEnabled);
+    bool IsEnabled() const { return bEnabled; }
+
+    /**
+     * @param   Rows            full scans of tables with at least this many rows are flagged
+     */
+    void SetLargeTableRows(int64 Rows);
+
+    /**
+     * Count a use of a WHERE shape
+     *
+     * @param   TableName       table the statement runs against
+     * @param   WhereClause     generated WHERE clause
+     * @return                  true the first time the shape is seen, the caller should Explain it
+     */
+    bool Observe(const FString& TableName, const FString& WhereClause);
+
+    /**
+     * Explain a newly observed shape
+     *
+     * @param   Database        connection to explain on
+     * @param   TableName       table the statement runs against
+     * @param   WhereClause     generated WHERE clause
+     * @param   Sql             full statement text
+     */
+    void Explain(sqlite3* Database, const FString& TableName, const FString& WhereClause, const FString& Sql);
+
+    /**
+     * Get every recorded shape, most used first
+     */
+    void GetShapes(TArray<FShape>& OutShapes) const;
+
+    /**
+     * Get the distinct index DDL recommended for flagged shapes, e.g. to paste into class metadata or run directly
+     */
+    void GetRecommendations(TArray<FString>& OutStatements) const;
+
+    /**
+     * Write every recorded shape, its plan and recommendation to the log
+     */
+    void LogReport() const;
+
+    /**
+     * Forget every recorded shape
+     */
+    void Reset();
+
+private:
+    /**
+     * Build the index that serves a WHERE clause: equality columns first, then the first range column.
+     * Disjunctions get an index per column instead.
+     */
+    static FString RecommendIndex(const FString& TableName, const FString& WhereClause);
+
+    bool bEnabled;
+    int64 LargeTableRows;
+
+    /** Keyed by "Table WHERE ..." */
+    TMap<FString, FShape> Shapes;
+    TMap<FString, int64> TableRowCounts;
+    mutable FCriticalSection Lock;
+};
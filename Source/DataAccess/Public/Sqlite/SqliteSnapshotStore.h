@@ -0,0 +1,126 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+class FSqliteClassSchema;
+typedef TSharedRef<const FSqliteClassSchema, ESPMode::ThreadSafe> FSqliteClassSchemaRef;
+
+/**
+ * Last persisted column values of records, keyed by class and Id.  Used to find the columns an update actually
+ * changes and to serve Id lookups without going to the database.  Values are kept as raw property memory laid out
+ * like the class, so comparing and copying go through the properties themselves.
+ *
+ * The store is bounded, past its capacity the least recently used records are forgotten.  Records are keyed by a weak
+ * class pointer and keep their schema alive, so records of a garbage collected or hot reloaded class are never matched
+ * again and can still be freed until they age out.
+ */
+class DATAACCESS_API SqliteSnapshotStore
+{
+public:
+    /**
+     * @param   Capacity    maximum number of records kept, 0 for no limit
+     */
+    SqliteSnapshotStore(int32 Capacity = 65536);
+    ~SqliteSnapshotStore();
+
+    /**
+     * Remember the current column values of an object as persisted
+     *
+     * @param   Schema      schema of the object's class
+     * @param   Container   object or memory laid out like the schema's class
+     */
+    void Store(const FSqliteClassSchema& Schema, const void* Container);
+
+    /**
+     * Copy the remembered column values of a record into an object
+     *
+     * @param   Schema      schema of the object's class
+     * @param   Id          record to load
+     * @param   Container   object or memory laid out like the schema's class
+     * @return              true if the record is known, false otherwise
+     */
+    bool Load(const FSqliteClassSchema& Schema, int32 Id, void* Container);
+
+    /**
+     * Compare an object against its snapshot
+     *
+     * @param   Schema          schema of the object's class
+     * @param   Container       object to compare
+     * @param   OutChangedMask  bit per entry of the schema's WritableColumns that differs from the snapshot
+     * @return                  true if a snapshot exists and the schema has at most 64 writable columns, false otherwise
+     */
+    bool Diff(const FSqliteClassSchema& Schema, const void* Container, uint64& OutChangedMask);
+
+    /**
+     * Forget one record
+     */
+    void Remove(const UClass* Class, int32 Id);
+
+    /**
+     * Forget every record of a class
+     */
+    void RemoveClass(const UClass* Class);
+
+    /**
+     * Forget everything
+     */
+    void Empty();
+
+    /**
+     * Change the number of records kept, forgetting the least recently used ones past it
+     *
+     * @param   NewCapacity     maximum number of records kept, 0 for no limit
+     */
+    void SetCapacity(int32 NewCapacity);
+
+    int32 Num() const;
+
+private:
+    struct FSnapshotKey
+    {
+        TWeakObjectPtr<const UClass> Class;
+        int32 Id;
+
+        FSnapshotKey(const UClass* Class, int32 Id)
+        : Class(Class)
+        , Id(Id)
+        {}
+
+        bool operator==(const FSnapshotKey& Other) const
+        {
+            return Class == Other.Class && Id == Other.Id;
+        }
+
+        friend uint32 GetTypeHash(const FSnapshotKey& Key)
+        {
+            return HashCombine(GetTypeHash(Key.Class), GetTypeHash(Key.Id));
+        }
+    };
+
+    /** A record's values, linked into the recently used list */
+    struct FSnapshot
+    {
+        FSnapshotKey Key;
+        FSqliteClassSchemaRef Schema;
+        uint8* Values;
+        FSnapshot* Prev;
+        FSnapshot* Next;
+
+        FSnapshot(const FSnapshotKey& Key, const FSqliteClassSchemaRef& Schema);
+        ~FSnapshot();
+    };
+
+    void Link(FSnapshot* Snapshot);
+    void Unlink(FSnapshot* Snapshot);
+    void Touch(FSnapshot* Snapshot);
+    void Free(FSnapshot* Snapshot);
+    void Trim();
+
+    int32 Capacity;
+    TMap<FSnapshotKey, FSnapshot*> Snapshots;
+
+    /** Most and least recently used records */
+    FSnapshot* Head;
+    FSnapshot* Tail;
+
+    mutable FCriticalSection Lock;
+};
@@ -0,0 +1,141 @@
+// Copyright 2015 afuzzyllama. All Rights Reserved.
+#pragma once
+
+typedef struct sqlite3 sqlite3;
+typedef struct sqlite3_stmt sqlite3_stmt;
+
+/**
+ * Kinds of statements the data handler generates
+ */
+namespace ESqliteStatementType
+{
+    enum Type
+    {
+        Insert,
+        InsertReturning,
+        InsertTimestamps,
+        Update,
+        UpdateReturning,
+        UpdateTimestamp,
+        Delete,
+        Count,
+        Select,
+        Aggregate,
+        UpdateWhere
+    };
+}
+
+/**
+ * Identifies a generated statement by the class it targets, what it does and the shape of its WHERE and ORDER BY clauses
+ */
+struct DATAACCESS_API FSqliteStatementKey
+{
+    /** Weak like the schema cache's keys, so a class recreated at the same address never gets the old layout's statements */
+    TWeakObjectPtr<const UClass> Class;
+    ESqliteStatementType::Type Type;
+    FString WhereClause;
+
+    /** Columns the statement touches, one bit per column.  0 means every column */
+    uint64 ColumnMask;
+
+    /** GROUP BY, ORDER BY, LIMIT and OFFSET of a select, empty otherwise */
+    FString OrderClause;
+
+    /** Result columns of an aggregate, e.g. "TestBool,SUM(TestInt)", or assignments of a set based update.  Empty otherwise */
+    FString ColumnList;
+
+    FSqliteStatementKey(const UClass* Class, ESqliteStatementType::Type Type, const FString& WhereClause, uint64 ColumnMask = 0, const FString& OrderClause = FString(), const FString& ColumnList = FString())
+    : Class(Class)
+    , Type(Type)
+    , WhereClause(WhereClause)
+    , ColumnMask(ColumnMask)
+    , OrderClause(OrderClause)
+    , ColumnList(ColumnList)
+    {}
+
+    bool operator==(const FSqliteStatementKey& Other) const
+    {
+        return Class == Other.Class && Type == Other.Type && ColumnMask == Other.ColumnMask &&
+               WhereClause.Equals(Other.WhereClause, ESearchCase::CaseSensitive) && OrderClause.Equals(Other.OrderClause, ESearchCase::CaseSensitive) &&
+               ColumnList.Equals(Other.ColumnList, ESearchCase::CaseSensitive);
+    }
+
+    friend uint32 GetTypeHash(const FSqliteStatementKey& Key)
+    {
+        uint32 Hash = HashCombine(GetTypeHash(Key.Class), GetTypeHash(static_cast<int32>(Key.Type)));
+        Hash = HashCombine(Hash, GetTypeHash(Key.ColumnMask));
+        Hash = HashCombine(Hash, FCrc::StrCrc32(*Key.WhereClause));
+        Hash = Key.OrderClause.IsEmpty() ? Hash : HashCombine(Hash, FCrc::StrCrc32(*Key.OrderClause));
+        return Key.ColumnList.IsEmpty() ? Hash : HashCombine(Hash, FCrc::StrCrc32(*Key.ColumnList));
+    }
+};
+
+/**
+ * Bounded LRU cache of prepared statements for a single sqlite connection.  Statements are checked out for the
+ * duration of one operation and reset when returned so the next caller can rebind them.  Statements of a collected
+ * class are never matched again and are evicted like any other unused statement.
+ */
+class DATAACCESS_API SqliteStatementCache
+{
+public:
+    /**
+     * @param   Capacity    maximum number of prepared statements kept alive
+     */
+    SqliteStatementCache(int32 Capacity = 64);
+    ~SqliteStatementCache();
+
+    /**
+     * Check out a cached statement
+     *
+     * @param   Key         statement to look for
+     * @return              a reset statement ready to be bound or nullptr on a miss
+     */
+    sqlite3_stmt* Checkout(const FSqliteStatementKey& Key);
+
+    /**
+     * Prepare a statement after a miss.  The statement is returned checked out.
+     *
+     * @param   Database    connection to prepare against
+     * @param   Key         key to cache the statement under
+     * @param   Sql         statement text
+     * @return              prepared statement or nullptr if sqlite could not prepare it
+     */
+    sqlite3_stmt* Prepare(sqlite3* Database, const FSqliteStatementKey& Key, const FString& Sql);
+
+    /**
+     * Return a checked out statement.  Cached statements are reset and their bindings cleared, uncached ones are finalized.
+     *
+     * @param   SqliteStatement     statement to return
+     */
+    void Return(sqlite3_stmt* SqliteStatement);
+
+    /**
+     * Finalize every cached statement.  Must be called before the owning connection is closed.  Checked out
+     * statements, e.g. of an open cursor, are forgotten instead and finalized when they are returned, so the
+     * connection has to be closed with sqlite3_close_v2.
+     */
+    void Flush();
+
+    uint64 GetHits() const { return Hits; }
+    uint64 GetMisses() const { return Misses; }
+    uint64 GetEvictions() const { return Evictions; }
+    int32 Num() const { return Entries.Num(); }
+
+private:
+    struct FEntry
+    {
+        sqlite3_stmt* Statement;
+        uint64 LastUsed;
+        bool bInUse;
+    };
+
+    int32 Capacity;
+    uint64 UseCounter;
+    uint64 Hits;
+    uint64 Misses;
+    uint64 Evictions;
+
+    TMap<FSqliteStatementKey, FEntry> Entries;
+    TMap<sqlite3_stmt*, FSqliteStatementKey> CachedKeys;
+    FCriticalSection Lock;
+};